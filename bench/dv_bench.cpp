@@ -0,0 +1,292 @@
+// Runs the engine over synthetic topologies and reports where the time
+// goes. Each case runs in a forked child so peak RSS is per case.
+
+#include "engine.hpp"
+#include "input.hpp"
+#include "output_writer.hpp"
+#include "topology_gen.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace dv::bench;
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    std::vector<Shape> shapes{Shape::ring, Shape::grid, Shape::er, Shape::ba};
+    std::vector<dv::NodeId> sizes{10, 100, 1000};
+    GenSpec spec;
+    unsigned threads = 1;
+    std::size_t max_memory_mb = 0; // 0: half of physical memory
+    bool csv = false;
+};
+
+// Sent from the child back to the parent through a pipe.
+struct CaseResult {
+    bool ok = false;
+    char error[160] = {};
+    std::uint64_t nodes = 0;
+    std::uint64_t links = 0;
+    double parse_ms = 0;
+    double build_ms = 0;
+    double converge_ms = 0;
+    double update_ms = 0;
+    std::uint64_t rounds = 0;
+    std::uint64_t evaluations = 0;
+    std::uint64_t advertisements = 0;
+    long peak_rss_kb = 0;
+};
+
+double ms_since(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+CaseResult run_case(const GenSpec& spec, unsigned threads)
+{
+    CaseResult r;
+    const std::string text = generate(spec);
+
+    auto start = Clock::now();
+    dv::Topology topo = dv::parse_input(text);
+    r.parse_ms = ms_since(start);
+    r.nodes = topo.names.size();
+    r.links = topo.links.size();
+
+    dv::EngineConfig config;
+    config.threads = threads;
+    config.tables = dv::TableOutput::none;
+    dv::OutputWriter out(open("/dev/null", O_WRONLY));
+
+    start = Clock::now();
+    dv::Engine<dv::Plain> engine(topo, config);
+    r.build_ms = ms_since(start);
+
+    start = Clock::now();
+    engine.converge(0, out);
+    r.converge_ms = ms_since(start);
+
+    start = Clock::now();
+    if (engine.apply_updates(topo.updates))
+        engine.converge(0, out);
+    r.update_ms = ms_since(start);
+
+    const dv::EngineStats& stats = engine.stats();
+    r.rounds = stats.rounds;
+    r.evaluations = stats.evaluations;
+    r.advertisements = stats.advertisements;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    r.peak_rss_kb = usage.ru_maxrss;
+    r.ok = true;
+    return r;
+}
+
+CaseResult run_isolated(const GenSpec& spec, unsigned threads)
+{
+    CaseResult r;
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::snprintf(r.error, sizeof(r.error), "pipe: %s", std::strerror(errno));
+        return r;
+    }
+    std::cout.flush();
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        CaseResult child;
+        try {
+            child = run_case(spec, threads);
+        } catch (const std::exception& e) {
+            std::snprintf(child.error, sizeof(child.error), "%s", e.what());
+        }
+        const ssize_t n = write(fds[1], &child, sizeof(child));
+        _exit(n == static_cast<ssize_t>(sizeof(child)) ? 0 : 1);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        std::snprintf(r.error, sizeof(r.error), "fork: %s", std::strerror(errno));
+        return r;
+    }
+    const ssize_t n = read(fds[0], &r, sizeof(r));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (n != static_cast<ssize_t>(sizeof(r))) {
+        r = CaseResult{};
+        std::snprintf(r.error, sizeof(r.error), "case died (status %d)", status);
+    }
+    return r;
+}
+
+std::size_t default_memory_limit_mb()
+{
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long page = sysconf(_SC_PAGE_SIZE);
+    if (pages <= 0 || page <= 0)
+        return 4096;
+    return static_cast<std::size_t>(pages) / 2 * static_cast<std::size_t>(page) >> 20;
+}
+
+// Two double-buffered matrices of cost and next hop per router.
+std::size_t table_memory_mb(dv::NodeId n)
+{
+    const std::size_t stride = (n + 15) / 16 * 16;
+    return 4 * sizeof(dv::Cost) * std::size_t(n) * stride >> 20;
+}
+
+template <typename T, typename Parse>
+std::vector<T> parse_list(const char* value, Parse parse)
+{
+    std::vector<T> items;
+    std::stringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ','))
+        items.push_back(parse(item));
+    return items;
+}
+
+void usage(std::ostream& out)
+{
+    out << "usage: dv_bench [options]\n"
+           "\n"
+           "  --shapes LIST       comma-separated ring,grid,er,ba,as (default ring,grid,er,ba)\n"
+           "  --sizes LIST        comma-separated node counts (default 10,100,1000)\n"
+           "  --degree D          average degree for er and ba (default 4)\n"
+           "  --updates K         random cost changes per case (default 10)\n"
+           "  --seed S            random seed (default 1)\n"
+           "  --threads N         engine threads (default 1, 0 = all cores)\n"
+           "  --as-rel FILE       CAIDA AS-relationship file for the as shape\n"
+           "  --max-memory-mb M   skip cases whose tables need more (default: half of RAM)\n"
+           "  --csv               machine-readable output\n";
+}
+
+BenchOptions parse_args(int argc, char** argv)
+{
+    BenchOptions opts;
+    opts.spec.updates = 10;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--csv") {
+            opts.csv = true;
+            continue;
+        }
+        if (arg == "-h" || arg == "--help") {
+            usage(std::cout);
+            std::exit(0);
+        }
+        if (i + 1 >= argc)
+            throw std::invalid_argument(std::string(arg) + " needs a value");
+        const char* value = argv[++i];
+        if (arg == "--shapes") {
+            opts.shapes = parse_list<Shape>(value, [](const std::string& s) {
+                Shape shape;
+                if (!parse_shape(s, shape))
+                    throw std::invalid_argument("unknown shape '" + s + "'");
+                return shape;
+            });
+        } else if (arg == "--sizes") {
+            opts.sizes = parse_list<dv::NodeId>(value, [](const std::string& s) {
+                return static_cast<dv::NodeId>(std::stoul(s));
+            });
+        } else if (arg == "--degree") {
+            opts.spec.degree = static_cast<unsigned>(std::stoul(value));
+        } else if (arg == "--updates") {
+            opts.spec.updates = static_cast<unsigned>(std::stoul(value));
+        } else if (arg == "--seed") {
+            opts.spec.seed = std::stoull(value);
+        } else if (arg == "--threads") {
+            opts.threads = static_cast<unsigned>(std::stoul(value));
+        } else if (arg == "--as-rel") {
+            opts.spec.as_rel_path = value;
+        } else if (arg == "--max-memory-mb") {
+            opts.max_memory_mb = std::stoul(value);
+        } else {
+            throw std::invalid_argument("unknown option '" + std::string(arg) + "'");
+        }
+    }
+    if (opts.max_memory_mb == 0)
+        opts.max_memory_mb = default_memory_limit_mb();
+    return opts;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    BenchOptions opts;
+    try {
+        opts = parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "dv_bench: " << e.what() << '\n';
+        usage(std::cerr);
+        return 2;
+    }
+
+    if (opts.csv) {
+        std::printf("shape,nodes,links,parse_ms,build_ms,converge_ms,update_ms,rounds,"
+                    "evaluations,messages,peak_rss_kb\n");
+    } else {
+        std::printf("%-5s %8s %9s %10s %10s %12s %10s %7s %12s %12s %10s\n", "shape", "nodes", "links",
+                    "parse ms", "build ms", "converge ms", "update ms", "rounds", "evaluations",
+                    "messages", "peak MiB");
+    }
+
+    bool failed = false;
+    for (Shape shape : opts.shapes) {
+        if (shape == Shape::as && opts.spec.as_rel_path.empty()) {
+            std::fprintf(stderr, "dv_bench: skipping as: no --as-rel file given\n");
+            continue;
+        }
+        for (dv::NodeId n : opts.sizes) {
+            if (table_memory_mb(n) > opts.max_memory_mb) {
+                std::fprintf(stderr, "dv_bench: skipping %s/%u: tables need %zu MiB\n", shape_name(shape),
+                             n, table_memory_mb(n));
+                continue;
+            }
+            GenSpec spec = opts.spec;
+            spec.shape = shape;
+            spec.nodes = n;
+            const CaseResult r = run_isolated(spec, opts.threads);
+            if (!r.ok) {
+                std::fprintf(stderr, "dv_bench: %s/%u failed: %s\n", shape_name(shape), n, r.error);
+                failed = true;
+                continue;
+            }
+            if (opts.csv) {
+                std::printf("%s,%llu,%llu,%.3f,%.3f,%.3f,%.3f,%llu,%llu,%llu,%ld\n", shape_name(shape),
+                            static_cast<unsigned long long>(r.nodes),
+                            static_cast<unsigned long long>(r.links), r.parse_ms, r.build_ms,
+                            r.converge_ms, r.update_ms, static_cast<unsigned long long>(r.rounds),
+                            static_cast<unsigned long long>(r.evaluations),
+                            static_cast<unsigned long long>(r.advertisements), r.peak_rss_kb);
+            } else {
+                std::printf("%-5s %8llu %9llu %10.2f %10.2f %12.2f %10.2f %7llu %12llu %12llu %10.1f\n",
+                            shape_name(shape), static_cast<unsigned long long>(r.nodes),
+                            static_cast<unsigned long long>(r.links), r.parse_ms,
+                            r.build_ms, r.converge_ms, r.update_ms,
+                            static_cast<unsigned long long>(r.rounds),
+                            static_cast<unsigned long long>(r.evaluations),
+                            static_cast<unsigned long long>(r.advertisements), r.peak_rss_kb / 1024.0);
+            }
+            std::fflush(stdout);
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,77 @@
+// Writes a synthetic topology in the DistanceVector input format to stdout.
+
+#include "topology_gen.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+void usage(std::ostream& out)
+{
+    out << "usage: dv_gen SHAPE NODES [options]\n"
+           "SHAPE is ring, grid, er, ba or as.\n"
+           "\n"
+           "  --degree D      average degree for er and ba (default 4)\n"
+           "  --max-cost C    link costs uniform in [1, C] (default 20)\n"
+           "  --max-delay MS  START link delays uniform in [1, MS] ms, for --simulate\n"
+           "                  (default none)\n"
+           "  --updates K     random cost changes in the UPDATE section (default 0)\n"
+           "  --seed S        random seed (default 1)\n"
+           "  --as-rel FILE   CAIDA AS-relationship file, required for as\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    using namespace dv::bench;
+
+    if (argc < 3) {
+        usage(std::cerr);
+        return 2;
+    }
+    GenSpec spec;
+    try {
+        if (!parse_shape(argv[1], spec.shape))
+            throw std::invalid_argument(std::string("unknown shape '") + argv[1] + "'");
+        spec.nodes = static_cast<dv::NodeId>(std::stoul(argv[2]));
+        for (int i = 3; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            if (i + 1 >= argc)
+                throw std::invalid_argument(std::string(arg) + " needs a value");
+            const char* value = argv[++i];
+            if (arg == "--degree")
+                spec.degree = static_cast<unsigned>(std::stoul(value));
+            else if (arg == "--max-cost")
+                spec.max_cost = static_cast<dv::Cost>(std::stol(value));
+            else if (arg == "--max-delay")
+                spec.max_delay = static_cast<unsigned>(std::stoul(value));
+            else if (arg == "--updates")
+                spec.updates = static_cast<unsigned>(std::stoul(value));
+            else if (arg == "--seed")
+                spec.seed = std::stoull(value);
+            else if (arg == "--as-rel")
+                spec.as_rel_path = value;
+            else
+                throw std::invalid_argument("unknown option '" + std::string(arg) + "'");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "dv_gen: " << e.what() << '\n';
+        usage(std::cerr);
+        return 2;
+    }
+
+    try {
+        const std::string text = generate(spec);
+        std::fwrite(text.data(), 1, text.size(), stdout);
+    } catch (const std::exception& e) {
+        std::cerr << "dv_gen: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+// Runs a program and writes its peak RSS, in KiB, to a file. Linux carries
+// a process's high-water mark across exec, so measuring a child forked
+// straight from a large parent, such as the Python that runs the bench,
+// reports the parent's size. Forked from this small process instead, the
+// child starts from a mark of a few hundred KiB.
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: dv_rss REPORT PROGRAM [ARGS...]\n"
+                             "Runs PROGRAM on this process's stdin, stdout and stderr, and writes\n"
+                             "its peak RSS in KiB to REPORT. Exits with PROGRAM's status.\n");
+        return 2;
+    }
+    const pid_t pid = fork();
+    if (pid == 0) {
+        execvp(argv[2], argv + 2);
+        std::fprintf(stderr, "dv_rss: cannot run %s: %s\n", argv[2], std::strerror(errno));
+        _exit(127);
+    }
+    if (pid < 0) {
+        std::fprintf(stderr, "dv_rss: fork: %s\n", std::strerror(errno));
+        return 2;
+    }
+    int status = 0;
+    struct rusage usage;
+    while (wait4(pid, &status, 0, &usage) < 0) {
+        if (errno != EINTR) {
+            std::fprintf(stderr, "dv_rss: wait: %s\n", std::strerror(errno));
+            return 2;
+        }
+    }
+    std::FILE* report = std::fopen(argv[1], "w");
+    if (!report || std::fprintf(report, "%ld\n", usage.ru_maxrss) < 0 || std::fclose(report) != 0) {
+        std::fprintf(stderr, "dv_rss: cannot write %s: %s\n", argv[1], std::strerror(errno));
+        return 2;
+    }
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
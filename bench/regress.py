@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""Regression gate for the native engine, run by the `bench` build target.
+
+Small synthetic topologies go through the Python reference once and
+through DistanceVector under each --check-flags variant, whose outputs
+must be identical to it; variants that print only routing tables are
+compared with the reference's routing tables. Larger ones go through
+dv_bench, timing convergence and the UPDATE section on a fixed generated
+input. Every case's time, peak RSS and advertisement count is appended to
+the history file, and the run fails if a case takes more than
+--max-slowdown percent longer than the median of its last --window
+passing runs.
+"""
+
+import argparse
+import csv
+import datetime
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+# Every option that claims the default output, one argv variant each;
+# {tmp} is a scratch directory.
+CHECK_FLAGS = ";".join([
+    "",
+    "--threads 4",
+    "--full-recompute",
+    "--kernel scalar",
+    "--compact",
+    "--reorder bfs",
+    "--reorder rcm",
+    "--partitions 3",
+    "--table-dir {tmp}",
+    "--async",
+    "--async --threads 4",
+    "--simulate",
+])
+
+# Variants that print only the routing tables.
+ROUTES_ONLY = ("--async", "--simulate")
+
+FIELDS = ["date", "commit", "engine", "shape", "nodes", "links", "seconds",
+          "peak_rss_kb", "messages", "result"]
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("--dv", required=True, help="DistanceVector binary")
+    p.add_argument("--gen", required=True, help="dv_gen binary")
+    p.add_argument("--bench", required=True, help="dv_bench binary")
+    p.add_argument("--rss", required=True, help="dv_rss binary")
+    p.add_argument("--reference", required=True, help="test/distance_vector.py")
+    p.add_argument("--history", required=True, help="CSV file runs are appended to")
+    p.add_argument("--source", default=".", help="git tree the commit is read from")
+    p.add_argument("--shapes", default="ring,grid,er,ba")
+    p.add_argument("--check-sizes", default="10,30,60",
+                   help="sizes run through both engines")
+    p.add_argument("--check-flags", default=CHECK_FLAGS,
+                   help="';'-separated DistanceVector option lists checked against "
+                        "the reference; {tmp} is a scratch directory")
+    p.add_argument("--check-delay", type=int, default=50,
+                   help="each check size is also run with link delays of up to this many "
+                        "ms; 0 skips it")
+    p.add_argument("--perf-sizes", default="1000,2000",
+                   help="sizes whose throughput is gated")
+    p.add_argument("--updates", type=int, default=5)
+    p.add_argument("--repeat", type=int, default=5,
+                   help="dv_bench runs per size; the fastest counts")
+    p.add_argument("--max-slowdown", type=float, default=10.0,
+                   help="allowed rise in a case's time, in percent")
+    p.add_argument("--window", type=int, default=5,
+                   help="passing runs the baseline is the median of")
+    return p.parse_args()
+
+
+def sizes(text):
+    return [int(s) for s in text.split(",") if s]
+
+
+def commit(source):
+    try:
+        out = subprocess.run(["git", "-C", source, "describe", "--always", "--dirty"],
+                             capture_output=True, text=True, check=True)
+        return out.stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def timed(args, argv, stdin, stdout, workdir):
+    """Runs argv under dv_rss; returns (wall seconds, peak RSS in KiB)."""
+    # A child of this process would start from Python's own RSS, which
+    # Linux carries across exec; dv_rss forks it from a small process.
+    report = os.path.join(workdir, "rss.txt")
+    start = time.monotonic()
+    proc = subprocess.run([args.rss, report] + argv, stdin=stdin, stdout=stdout,
+                          stderr=subprocess.PIPE)
+    seconds = time.monotonic() - start
+    if proc.returncode != 0:
+        err = proc.stderr.decode(errors="replace").strip()
+        raise RuntimeError(f"{os.path.basename(argv[-1])} exited {proc.returncode}: {err}")
+    with open(report) as f:
+        return seconds, int(f.read())
+
+
+def load_history(path):
+    """The history's rows, and whether its header is FIELDS."""
+    if not os.path.exists(path):
+        return [], True
+    with open(path, newline="") as f:
+        reader = csv.DictReader(f)
+        rows = list(reader)
+    return rows, reader.fieldnames == FIELDS
+
+
+def baseline(history, shape, nodes, window):
+    """The median time of the case's last window passing dv_bench runs."""
+    runs = [float(r["seconds"]) for r in history
+            if r["engine"] == "dv_bench" and r["shape"] == shape
+            and r["nodes"] == str(nodes) and r["result"] == "ok"]
+    return statistics.median(runs[-window:]) if runs else None
+
+
+def routing_tables(output):
+    """The routing table blocks of a full run's output, in order."""
+    blocks = output.split(b"\n\n")
+    return b"".join(b + b"\n\n" for b in blocks if b.startswith(b"Routing Table of router "))
+
+
+def check_case(args, shape, n, workdir, max_delay=0):
+    """The reference and every flag variant on one topology, with link
+    delays of up to max_delay ms if it is set; returns their history rows,
+    the reference's first."""
+    topo = os.path.join(workdir, "input.txt")
+    gen = [args.gen, shape, str(n), "--updates", str(args.updates)]
+    if max_delay:
+        gen += ["--max-delay", str(max_delay)]
+        shape += "+delay"
+    with open(topo, "wb") as f:
+        subprocess.run(gen, stdout=f, check=True)
+    links = 0
+    with open(topo) as f:
+        section = 0
+        for line in f:
+            line = line.strip()
+            if line in ("START", "UPDATE"):
+                section += 1
+            elif section == 1:
+                links += 1
+
+    def run(engine, argv):
+        out_path = os.path.join(workdir, "output.txt")
+        with open(topo, "rb") as stdin, open(out_path, "wb") as stdout:
+            seconds, rss = timed(args, argv, stdin, stdout, workdir)
+        with open(out_path, "rb") as f:
+            output = f.read()
+        return output, {"engine": engine, "shape": shape, "nodes": n, "links": links,
+                        "seconds": f"{seconds:.4f}", "peak_rss_kb": rss, "messages": "",
+                        "result": "ok"}
+
+    expected, reference = run("python", [sys.executable, args.reference])
+    expected_routes = routing_tables(expected)
+    rows = [reference]
+    for flags in args.check_flags.split(";"):
+        argv = flags.replace("{tmp}", workdir).split()
+        output, row = run(" ".join(["native"] + flags.split()), [args.dv] + argv)
+        routes_only = any(f in argv for f in ROUTES_ONLY)
+        if output != (expected_routes if routes_only else expected):
+            row["result"] = "mismatch"
+        rows.append(row)
+    return rows
+
+
+def perf_case(args, shape, n):
+    """n-router cases of shape through dv_bench; returns the fastest's row."""
+    best = None
+    for _ in range(args.repeat):
+        out = subprocess.run([args.bench, "--csv", "--shapes", shape, "--sizes", str(n),
+                              "--updates", str(args.updates)],
+                             capture_output=True, text=True, check=True)
+        rows = list(csv.DictReader(out.stdout.splitlines()))
+        if not rows:
+            raise RuntimeError(f"dv_bench ran no {shape}/{n} case: {out.stderr.strip()}")
+        r = rows[0]
+        seconds = (float(r["converge_ms"]) + float(r["update_ms"])) / 1000
+        if best is None or seconds < best["seconds"]:
+            best = {"seconds": seconds, "links": r["links"], "peak_rss_kb": r["peak_rss_kb"],
+                    "messages": r["messages"]}
+    return {"engine": "dv_bench", "shape": shape, "nodes": n, "links": best["links"],
+            "seconds": f"{best['seconds']:.4f}", "peak_rss_kb": best["peak_rss_kb"],
+            "messages": best["messages"]}
+
+
+def main():
+    args = parse_args()
+    history, current = load_history(args.history)
+    stamp = {"date": datetime.datetime.now().isoformat(timespec="seconds"),
+             "commit": commit(args.source)}
+    rows = []
+    failures = []
+
+    with tempfile.TemporaryDirectory() as workdir:
+        delays = [0] + ([args.check_delay] if args.check_delay else [])
+        for shape in args.shapes.split(","):
+            for max_delay in delays:
+                for n in sizes(args.check_sizes):
+                    python, *natives = check_case(args, shape, n, workdir, max_delay)
+                    rows += [python] + natives
+                    case = python["shape"]
+                    differ = [r["engine"] for r in natives if r["result"] != "ok"]
+                    status = "identical" if not differ else f"{len(differ)} DIFFERENT"
+                    print(f"check {case:<10} {n:>6}: {len(natives)} variants {status}; "
+                          f"native {natives[0]['seconds']} s, python {python['seconds']} s")
+                    for engine in differ:
+                        failures.append(f"{case}/{n}: `{engine}` output differs from the reference")
+
+    for shape in args.shapes.split(","):
+        for n in sizes(args.perf_sizes):
+            row = perf_case(args, shape, n)
+            base = baseline(history, shape, n, args.window)
+            seconds = float(row["seconds"])
+            change = ""
+            row["result"] = "ok"
+            if base:
+                slowdown = 100 * (seconds - base) / base
+                change = f", {slowdown:+.1f}% against {base:.4f} s"
+                if slowdown > args.max_slowdown:
+                    row["result"] = "slow"
+                    failures.append(f"{shape}/{n}: time rose {slowdown:.1f}% "
+                                    f"(limit {args.max_slowdown:g}%)")
+            rows.append(row)
+            print(f"perf  {shape:<4} {n:>6}: {seconds:.4f} s, {row['messages']} advertisements, "
+                  f"{int(row['peak_rss_kb']) / 1024:.1f} MiB{change}")
+
+    # A history written under another header is rewritten under this one,
+    # with the columns its rows lack left empty.
+    with open(args.history, "a" if current else "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=FIELDS, restval="", extrasaction="ignore")
+        if f.tell() == 0:
+            writer.writeheader()
+        if not current:
+            writer.writerows(history)
+        writer.writerows({**stamp, **row} for row in rows)
+    print(f"appended {len(rows)} rows to {args.history}")
+
+    for failure in failures:
+        print(f"regress: {failure}", file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    try:
+        sys.exit(main())
+    except (OSError, RuntimeError, subprocess.CalledProcessError) as e:
+        print(f"regress: {e}", file=sys.stderr)
+        sys.exit(2)
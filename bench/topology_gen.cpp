@@ -0,0 +1,263 @@
+#include "topology_gen.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace dv::bench {
+
+namespace {
+
+using Edge = std::pair<NodeId, NodeId>;
+using Rng = std::mt19937_64;
+
+std::uint64_t edge_key(NodeId u, NodeId v)
+{
+    if (u > v)
+        std::swap(u, v);
+    return (static_cast<std::uint64_t>(u) << 32) | v;
+}
+
+std::vector<Edge> ring(NodeId n)
+{
+    std::vector<Edge> edges;
+    if (n < 2)
+        return edges;
+    for (NodeId i = 0; i + 1 < n; ++i)
+        edges.emplace_back(i, i + 1);
+    if (n > 2)
+        edges.emplace_back(n - 1, 0);
+    return edges;
+}
+
+std::vector<Edge> grid(NodeId n)
+{
+    const auto width = static_cast<NodeId>(std::ceil(std::sqrt(static_cast<double>(n))));
+    std::vector<Edge> edges;
+    for (NodeId i = 0; i < n; ++i) {
+        if ((i + 1) % width != 0 && i + 1 < n)
+            edges.emplace_back(i, i + 1);
+        if (i + width < n)
+            edges.emplace_back(i, i + width);
+    }
+    return edges;
+}
+
+std::vector<Edge> erdos_renyi(NodeId n, unsigned degree, Rng& rng)
+{
+    std::vector<Edge> edges;
+    if (n < 2)
+        return edges;
+    const std::uint64_t possible = std::uint64_t(n) * (n - 1) / 2;
+    const std::uint64_t m = std::min<std::uint64_t>(possible, std::uint64_t(n) * degree / 2);
+    std::uniform_int_distribution<NodeId> pick(0, n - 1);
+    std::unordered_set<std::uint64_t> seen;
+    while (edges.size() < m) {
+        const NodeId u = pick(rng), v = pick(rng);
+        if (u != v && seen.insert(edge_key(u, v)).second)
+            edges.emplace_back(u, v);
+    }
+    return edges;
+}
+
+std::vector<Edge> barabasi_albert(NodeId n, unsigned degree, Rng& rng)
+{
+    const NodeId m = std::max(1u, degree / 2);
+    std::vector<Edge> edges;
+    // Every link endpoint, so a uniform pick is degree-proportional.
+    std::vector<NodeId> endpoints;
+    const NodeId seed_nodes = std::min(n, m + 1);
+    for (NodeId u = 0; u < seed_nodes; ++u) {
+        for (NodeId v = u + 1; v < seed_nodes; ++v) {
+            edges.emplace_back(u, v);
+            endpoints.push_back(u);
+            endpoints.push_back(v);
+        }
+    }
+    std::vector<NodeId> targets;
+    for (NodeId u = seed_nodes; u < n; ++u) {
+        targets.clear();
+        while (targets.size() < m) {
+            std::uniform_int_distribution<std::size_t> pick(0, endpoints.size() - 1);
+            const NodeId v = endpoints[pick(rng)];
+            if (std::find(targets.begin(), targets.end(), v) == targets.end())
+                targets.push_back(v);
+        }
+        for (NodeId v : targets) {
+            edges.emplace_back(u, v);
+            endpoints.push_back(u);
+            endpoints.push_back(v);
+        }
+    }
+    return edges;
+}
+
+// Reads "as1|as2|relationship" lines and keeps the BFS ball of up to n ASes
+// around the best-connected one. AS numbers become the router names.
+std::vector<Edge> as_level(const GenSpec& spec, std::vector<std::string>& names)
+{
+    std::ifstream in(spec.as_rel_path);
+    if (!in)
+        throw std::runtime_error("cannot read AS relationships from '" + spec.as_rel_path + "'");
+
+    std::unordered_map<std::string, NodeId> ids;
+    std::vector<std::string> asns;
+    std::vector<std::vector<NodeId>> adj;
+    auto id_of = [&](const std::string& asn) {
+        auto [it, inserted] = ids.try_emplace(asn, static_cast<NodeId>(asns.size()));
+        if (inserted) {
+            asns.push_back(asn);
+            adj.emplace_back();
+        }
+        return it->second;
+    };
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        const auto bar1 = line.find('|');
+        const auto bar2 = line.find('|', bar1 + 1);
+        if (bar1 == std::string::npos || bar2 == std::string::npos)
+            continue;
+        const NodeId u = id_of(line.substr(0, bar1));
+        const NodeId v = id_of(line.substr(bar1 + 1, bar2 - bar1 - 1));
+        if (u != v) {
+            adj[u].push_back(v);
+            adj[v].push_back(u);
+        }
+    }
+    if (asns.empty())
+        throw std::runtime_error("no AS relationships in '" + spec.as_rel_path + "'");
+
+    NodeId root = 0;
+    for (NodeId u = 0; u < asns.size(); ++u) {
+        if (adj[u].size() > adj[root].size())
+            root = u;
+    }
+    std::vector<NodeId> local(asns.size(), kNoNode);
+    std::vector<NodeId> order{root};
+    local[root] = 0;
+    for (std::size_t head = 0; head < order.size() && order.size() < spec.nodes; ++head) {
+        for (NodeId v : adj[order[head]]) {
+            if (local[v] == kNoNode && order.size() < spec.nodes) {
+                local[v] = static_cast<NodeId>(order.size());
+                order.push_back(v);
+            }
+        }
+    }
+
+    std::vector<Edge> edges;
+    std::unordered_set<std::uint64_t> seen;
+    for (NodeId u : order) {
+        names.push_back("AS" + asns[u]);
+        for (NodeId v : adj[u]) {
+            if (local[v] != kNoNode && seen.insert(edge_key(local[u], local[v])).second)
+                edges.emplace_back(local[u], local[v]);
+        }
+    }
+    return edges;
+}
+
+} // namespace
+
+bool parse_shape(std::string_view name, Shape& shape)
+{
+    for (Shape s : {Shape::ring, Shape::grid, Shape::er, Shape::ba, Shape::as}) {
+        if (name == shape_name(s)) {
+            shape = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* shape_name(Shape shape)
+{
+    switch (shape) {
+    case Shape::ring:
+        return "ring";
+    case Shape::grid:
+        return "grid";
+    case Shape::er:
+        return "er";
+    case Shape::ba:
+        return "ba";
+    case Shape::as:
+        return "as";
+    }
+    return "?";
+}
+
+std::string generate(const GenSpec& spec)
+{
+    Rng rng(spec.seed);
+    std::vector<std::string> names;
+    std::vector<Edge> edges;
+    switch (spec.shape) {
+    case Shape::ring:
+        edges = ring(spec.nodes);
+        break;
+    case Shape::grid:
+        edges = grid(spec.nodes);
+        break;
+    case Shape::er:
+        edges = erdos_renyi(spec.nodes, spec.degree, rng);
+        break;
+    case Shape::ba:
+        edges = barabasi_albert(spec.nodes, spec.degree, rng);
+        break;
+    case Shape::as:
+        edges = as_level(spec, names);
+        break;
+    }
+    if (names.empty()) {
+        for (NodeId i = 0; i < spec.nodes; ++i)
+            names.push_back("r" + std::to_string(i));
+    }
+
+    std::uniform_int_distribution<Cost> cost(1, std::max<Cost>(1, spec.max_cost));
+    std::uniform_int_distribution<unsigned> delay(1, std::max(1u, spec.max_delay));
+    std::string text;
+    text.reserve(names.size() * 8 + edges.size() * 20);
+    for (const auto& name : names) {
+        text += name;
+        text += '\n';
+    }
+    text += "START\n";
+    for (const auto& [u, v] : edges) {
+        text += names[u];
+        text += ' ';
+        text += names[v];
+        text += ' ';
+        text += std::to_string(cost(rng));
+        if (spec.max_delay > 0) {
+            text += ' ';
+            text += std::to_string(delay(rng));
+        }
+        text += '\n';
+    }
+    text += "UPDATE\n";
+    if (!edges.empty()) {
+        std::uniform_int_distribution<std::size_t> pick(0, edges.size() - 1);
+        for (unsigned i = 0; i < spec.updates; ++i) {
+            const auto& [u, v] = edges[pick(rng)];
+            text += names[u];
+            text += ' ';
+            text += names[v];
+            text += ' ';
+            text += std::to_string(cost(rng));
+            text += '\n';
+        }
+    }
+    text += "END\n";
+    return text;
+}
+
+} // namespace dv::bench
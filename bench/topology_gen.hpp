@@ -0,0 +1,38 @@
+#pragma once
+
+#include "cost.hpp"
+#include "names.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace dv::bench {
+
+enum class Shape {
+    ring,
+    grid, // 4-neighbour lattice, as square as the node count allows
+    er,   // Erdős–Rényi G(n, m) with m = n * degree / 2
+    ba,   // Barabási–Albert, each new node attaching degree / 2 links
+    as,   // BFS-connected sample of a CAIDA AS-relationship file
+};
+
+struct GenSpec {
+    Shape shape = Shape::ring;
+    NodeId nodes = 100;
+    unsigned degree = 4;
+    Cost max_cost = 20;    // link costs are uniform in [1, max_cost]
+    unsigned max_delay = 0; // START link delays uniform in [1, max_delay] ms; 0: none
+    unsigned updates = 0;  // random cost changes on existing links
+    std::uint64_t seed = 1;
+    std::string as_rel_path; // required for Shape::as
+};
+
+bool parse_shape(std::string_view name, Shape& shape);
+const char* shape_name(Shape shape);
+
+// Renders the topology as START/UPDATE/END input. Throws
+// std::runtime_error if an AS-relationship file is needed but unreadable.
+std::string generate(const GenSpec& spec);
+
+} // namespace dv::bench
@@ -0,0 +1,62 @@
+#include "arena.hpp"
+
+#include <algorithm>
+
+namespace dv {
+
+Arena::Arena(std::size_t chunk_size)
+    : chunk_size_(chunk_size)
+{
+}
+
+void Arena::add_chunk(std::size_t min_size)
+{
+    const std::size_t size = std::max(chunk_size_, min_size);
+    // Left uninitialized: new[] rather than make_unique, which zeroes.
+    chunks_.push_back(Chunk{std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+}
+
+void* Arena::allocate(std::size_t bytes, std::size_t align)
+{
+    while (true) {
+        if (chunk_ < chunks_.size()) {
+            const Chunk& c = chunks_[chunk_];
+            const auto base = reinterpret_cast<std::uintptr_t>(c.data.get());
+            const std::size_t start = ((base + offset_ + align - 1) & ~(align - 1)) - base;
+            if (start + bytes <= c.size) {
+                used_ += start + bytes - offset_;
+                peak_ = std::max(peak_, used_);
+                offset_ = start + bytes;
+                return c.data.get() + start;
+            }
+            // Abandon the tail of this chunk.
+            used_ += c.size - offset_;
+            ++chunk_;
+            offset_ = 0;
+            continue;
+        }
+        add_chunk(bytes + align);
+    }
+}
+
+void Arena::reset()
+{
+    if (chunks_.size() > 1) {
+        const std::size_t total = reserved();
+        chunks_.clear();
+        add_chunk(total);
+    }
+    chunk_ = 0;
+    offset_ = 0;
+    used_ = 0;
+}
+
+std::size_t Arena::reserved() const
+{
+    std::size_t total = 0;
+    for (const Chunk& c : chunks_)
+        total += c.size;
+    return total;
+}
+
+} // namespace dv
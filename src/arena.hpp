@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace dv {
+
+// Bump allocator. Allocations are never freed individually; reset()
+// rewinds the whole arena, keeping its memory for the next use. Only
+// trivially destructible types may live here.
+class Arena {
+public:
+    explicit Arena(std::size_t chunk_size = std::size_t(1) << 16);
+    Arena(Arena&&) noexcept = default;
+    Arena& operator=(Arena&&) noexcept = default;
+
+    void* allocate(std::size_t bytes, std::size_t align);
+
+    // Uninitialized storage for count objects of T.
+    template <typename T>
+    T* allocate_array(std::size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Invalidates every allocation. If the last cycle spilled into more
+    // than one chunk they are merged, so steady-state cycles bump through
+    // a single block.
+    void reset();
+
+    std::size_t used() const { return used_; }
+    std::size_t peak() const { return peak_; }
+    std::size_t reserved() const;
+
+private:
+    struct Chunk {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size;
+    };
+
+    void add_chunk(std::size_t min_size);
+
+    std::size_t chunk_size_;
+    std::vector<Chunk> chunks_;
+    std::size_t chunk_ = 0;  // chunk currently bumped
+    std::size_t offset_ = 0; // bytes used in chunk_
+    std::size_t used_ = 0;
+    std::size_t peak_ = 0;
+};
+
+} // namespace dv
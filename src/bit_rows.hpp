@@ -0,0 +1,84 @@
+#pragma once
+
+#include "lazy_array.hpp"
+#include "names.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace dv {
+
+// One fixed-width bitset per router over destinations, packed into 64-bit
+// words. Set bits are visited with count-trailing-zeros, so a sparse row
+// costs one test per empty word and one step per set bit. Rows that are
+// never touched take no memory, and with a TableFile the rest can be
+// evicted.
+class BitRows {
+public:
+    using Word = std::uint64_t;
+    static constexpr std::size_t kWordBits = 64;
+
+    BitRows() = default;
+    BitRows(NodeId rows, std::size_t bits, TableFile* file = nullptr)
+        : width_(bits)
+        , words_((bits + kWordBits - 1) / kWordBits)
+        , bits_(rows * words_, file)
+    {
+    }
+
+    std::size_t words() const { return words_; }
+
+    Word* row(NodeId x) { return bits_.data() + x * words_; }
+    const Word* row(NodeId x) const { return bits_.data() + x * words_; }
+
+    void clear_row(NodeId x) { std::fill_n(row(x), words_, 0); }
+    // Sets every bit of row x.
+    void fill_row(NodeId x)
+    {
+        std::fill_n(row(x), words_, ~Word{0});
+        if (width_ % kWordBits != 0)
+            row(x)[words_ - 1] = (Word{1} << (width_ % kWordBits)) - 1;
+    }
+
+    static void set(Word* row, std::size_t i) { row[i / kWordBits] |= Word{1} << (i % kWordBits); }
+    static bool test(const Word* row, std::size_t i) { return (row[i / kWordBits] >> (i % kWordBits)) & 1; }
+
+    std::size_t count(const Word* row) const { return count(row, 0, words_); }
+    // Set bits in words [first, last).
+    static std::size_t count(const Word* row, std::size_t first, std::size_t last)
+    {
+        std::size_t n = 0;
+        for (std::size_t w = first; w < last; ++w)
+            n += static_cast<std::size_t>(__builtin_popcountll(row[w]));
+        return n;
+    }
+
+    bool any(const Word* row) const
+    {
+        return std::any_of(row, row + words_, [](Word w) { return w != 0; });
+    }
+
+    // Calls f(i) for every set bit in ascending order.
+    template <typename F>
+    void for_each(const Word* row, F&& f) const
+    {
+        for_each(row, 0, words_, f);
+    }
+    // The same over words [first, last).
+    template <typename F>
+    static void for_each(const Word* row, std::size_t first, std::size_t last, F&& f)
+    {
+        for (std::size_t w = first; w < last; ++w) {
+            for (Word bits = row[w]; bits != 0; bits &= bits - 1)
+                f(w * kWordBits + static_cast<std::size_t>(__builtin_ctzll(bits)));
+        }
+    }
+
+private:
+    std::size_t width_ = 0;
+    std::size_t words_ = 0;
+    LazyArray<Word> bits_;
+};
+
+} // namespace dv
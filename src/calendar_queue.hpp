@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace dv {
+
+// Calendar queue for a discrete-event simulation in which no event is
+// scheduled more than a fixed horizon past the one last popped. Time is cut
+// into buckets of width ticks, kept in a ring long enough to cover the
+// horizon, so a push is an append to its bucket. Only the bucket holding
+// the present is ordered, sorted latest first when the queue reaches it so
+// that a pop takes the back. With width at most the shortest delay, every
+// push lands in a later bucket. The ring is capped at kMaxBuckets, though,
+// widening the buckets past that when the horizon is far off, and pushes
+// into the present bucket then go to a heap beside it.
+//
+// Event must have an unsigned time member; Later(a, b) says whether a
+// comes after b, with ties among equal times broken any way the caller
+// likes.
+template <typename Event, typename Later>
+class CalendarQueue {
+public:
+    static constexpr std::size_t kMaxBuckets = 4096;
+
+    CalendarQueue() = default;
+    CalendarQueue(std::uint64_t width, std::uint64_t horizon)
+        : width_(std::max<std::uint64_t>(
+            {width, 1, (horizon + kMaxBuckets - 3) / (kMaxBuckets - 2)}))
+    {
+        std::size_t size = 1;
+        while (size < horizon / width_ + 2)
+            size *= 2;
+        mask_ = size - 1;
+        buckets_.resize(size);
+    }
+
+    bool empty() const { return size_ == 0; }
+    std::size_t size() const { return size_; }
+    std::uint64_t width() const { return width_; }
+    std::size_t bucket_count() const { return buckets_.size(); }
+
+    // e.time must be no earlier than the last event popped, and no more
+    // than the horizon after it. It may be earlier than the bucket a top()
+    // since then moved on to, which is then put back.
+    void push(const Event& e)
+    {
+        const std::uint64_t bucket = e.time / width_;
+        if (bucket < cursor_) {
+            current_.insert(current_.end(), late_.begin(), late_.end());
+            late_.clear();
+            std::swap(current_, buckets_[cursor_ & mask_]);
+            cursor_ = bucket;
+            std::swap(current_, buckets_[cursor_ & mask_]);
+            std::sort(current_.begin(), current_.end(), Later{});
+        }
+        if (bucket == cursor_) {
+            late_.push_back(e);
+            std::push_heap(late_.begin(), late_.end(), Later{});
+        } else {
+            buckets_[bucket & mask_].push_back(e);
+        }
+        ++size_;
+    }
+
+    // The earliest event; the queue must not be empty.
+    const Event& top()
+    {
+        while (current_.empty() && late_.empty()) {
+            ++cursor_;
+            std::swap(current_, buckets_[cursor_ & mask_]);
+            std::sort(current_.begin(), current_.end(), Later{});
+        }
+        return *next_in_bucket();
+    }
+
+    // The earliest event if it is in the bucket being popped, else null.
+    // Unlike top(), never moves on to the next bucket, which pushes made
+    // before the next pop might then land in.
+    const Event* next_in_bucket() const
+    {
+        if (late_.empty())
+            return current_.empty() ? nullptr : &current_.back();
+        if (current_.empty() || Later{}(current_.back(), late_.front()))
+            return &late_.front();
+        return &current_.back();
+    }
+
+    void pop()
+    {
+        const Event* e = &top();
+        if (!current_.empty() && e == &current_.back()) {
+            current_.pop_back();
+        } else {
+            std::pop_heap(late_.begin(), late_.end(), Later{});
+            late_.pop_back();
+        }
+        --size_;
+    }
+
+private:
+    std::uint64_t width_ = 1;
+    std::size_t mask_ = 0;
+    std::vector<std::vector<Event>> buckets_;
+    std::vector<Event> current_; // bucket cursor_, latest first
+    std::vector<Event> late_;    // pushed into bucket cursor_ since, as a heap
+    std::uint64_t cursor_ = 0;
+    std::size_t size_ = 0;
+};
+
+} // namespace dv
@@ -0,0 +1,432 @@
+#include "cluster.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace dv {
+
+namespace {
+
+constexpr std::size_t kReadSize = std::size_t(1) << 16;
+
+[[noreturn]] void fail(const std::string& what)
+{
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+[[noreturn]] void closed()
+{
+    throw std::runtime_error("a partition process closed its connection");
+}
+
+// Each message between workers is its length followed by its bytes.
+struct Transfer {
+    std::uint64_t length = 0;
+    std::size_t done = 0; // bytes of length and body so far
+};
+
+std::size_t frame_size(const Transfer& t) { return sizeof t.length + t.length; }
+
+} // namespace
+
+Channel::Channel(int fd)
+    : fd_(fd)
+{
+}
+
+Channel::Channel(Channel&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1))
+    , buf_(std::move(other.buf_))
+    , begin_(other.begin_)
+    , end_(other.end_)
+{
+}
+
+Channel& Channel::operator=(Channel&& other) noexcept
+{
+    if (this != &other) {
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = std::exchange(other.fd_, -1);
+        buf_ = std::move(other.buf_);
+        begin_ = other.begin_;
+        end_ = other.end_;
+    }
+    return *this;
+}
+
+Channel::~Channel()
+{
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+void Channel::send(const void* data, std::size_t size)
+{
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t sent = ::send(fd_, p, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EPIPE || errno == ECONNRESET)
+                closed();
+            fail("cannot write to a partition process");
+        }
+        p += sent;
+        size -= static_cast<std::size_t>(sent);
+    }
+}
+
+bool Channel::fill()
+{
+    if (begin_ > 0) {
+        std::memmove(buf_.data(), buf_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+    }
+    if (buf_.size() - end_ < kReadSize)
+        buf_.resize(end_ + kReadSize);
+    while (true) {
+        const ssize_t got = ::read(fd_, buf_.data() + end_, buf_.size() - end_);
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == ECONNRESET)
+                return false;
+            fail("cannot read from a partition process");
+        }
+        end_ += static_cast<std::size_t>(got);
+        return got > 0;
+    }
+}
+
+void Channel::receive(void* data, std::size_t size)
+{
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        if (begin_ == end_ && !fill())
+            closed();
+        const std::size_t take = std::min(size, end_ - begin_);
+        std::memcpy(p, buf_.data() + begin_, take);
+        begin_ += take;
+        p += take;
+        size -= take;
+    }
+}
+
+void Channel::copy_lines(std::size_t lines, OutputWriter& out)
+{
+    while (lines > 0) {
+        if (begin_ == end_ && !fill())
+            closed();
+        const char* first = buf_.data() + begin_;
+        const char* last = buf_.data() + end_;
+        const char* p = first;
+        while (lines > 0) {
+            const void* nl = std::memchr(p, '\n', static_cast<std::size_t>(last - p));
+            if (nl == nullptr)
+                break;
+            p = static_cast<const char*>(nl) + 1;
+            --lines;
+        }
+        out.write_lines(std::string_view(first, static_cast<std::size_t>(p - first)));
+        begin_ += static_cast<std::size_t>(p - first);
+        // A line cut off at the end of the buffer waits for more input.
+        if (lines > 0 && begin_ < end_ && !fill())
+            closed();
+    }
+}
+
+WorkerLinks::WorkerLinks(std::uint32_t self, const std::vector<std::uint32_t>& part, Channel coordinator,
+                         std::vector<Channel> peers)
+    : self_(self)
+    , part_(part)
+    , coordinator_(std::move(coordinator))
+    , peers_(std::move(peers))
+    , out_(coordinator_.fd())
+{
+    for (std::uint32_t q = 0; q < parts(); ++q) {
+        if (q != self_ && ::fcntl(peers_[q].fd(), F_SETFL, O_NONBLOCK) < 0)
+            fail("cannot set up a partition connection");
+    }
+}
+
+bool WorkerLinks::report_round(bool changed, const std::vector<NodeId>& printed)
+{
+    // The coordinator reads the last round's tables before this report.
+    out_.flush();
+    const std::uint8_t flag = changed;
+    const auto count = static_cast<std::uint32_t>(printed.size());
+    coordinator_.send(&flag, sizeof flag);
+    coordinator_.send(&count, sizeof count);
+    coordinator_.send(printed.data(), printed.size() * sizeof(NodeId));
+    std::uint8_t any = 0;
+    coordinator_.receive(&any, sizeof any);
+    return any != 0;
+}
+
+void WorkerLinks::exchange(std::vector<std::vector<char>>& outbox, std::vector<std::vector<char>>& inbox)
+{
+    const unsigned p = parts();
+    std::vector<Transfer> sending(p), receiving(p);
+    std::vector<pollfd> fds;
+    std::vector<std::uint32_t> peer_of;
+    for (std::uint32_t q = 0; q < p; ++q) {
+        sending[q].length = outbox[q].size();
+        inbox[q].clear();
+    }
+
+    const auto finished = [&](std::uint32_t q) {
+        return (sending[q].done == frame_size(sending[q]))
+            && receiving[q].done >= sizeof(std::uint64_t) && receiving[q].done == frame_size(receiving[q]);
+    };
+
+    while (true) {
+        fds.clear();
+        peer_of.clear();
+        for (std::uint32_t q = 0; q < p; ++q) {
+            if (q == self_ || finished(q))
+                continue;
+            short events = 0;
+            if (sending[q].done < frame_size(sending[q]))
+                events |= POLLOUT;
+            if (receiving[q].done < sizeof(std::uint64_t) || receiving[q].done < frame_size(receiving[q]))
+                events |= POLLIN;
+            fds.push_back({peers_[q].fd(), events, 0});
+            peer_of.push_back(q);
+        }
+        if (fds.empty())
+            break;
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            fail("cannot wait for a partition process");
+        }
+
+        for (std::size_t i = 0; i < fds.size(); ++i) {
+            const std::uint32_t q = peer_of[i];
+            const int fd = fds[i].fd;
+            if (fds[i].revents & POLLOUT) {
+                Transfer& s = sending[q];
+                const char* data;
+                std::size_t size;
+                if (s.done < sizeof s.length) {
+                    data = reinterpret_cast<const char*>(&s.length) + s.done;
+                    size = sizeof s.length - s.done;
+                } else {
+                    data = outbox[q].data() + (s.done - sizeof s.length);
+                    size = frame_size(s) - s.done;
+                }
+                const ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+                if (sent < 0 && errno != EAGAIN && errno != EINTR) {
+                    if (errno == EPIPE || errno == ECONNRESET)
+                        closed();
+                    fail("cannot write to a partition process");
+                }
+                if (sent > 0)
+                    s.done += static_cast<std::size_t>(sent);
+            }
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                Transfer& r = receiving[q];
+                char* data;
+                std::size_t size;
+                if (r.done < sizeof r.length) {
+                    data = reinterpret_cast<char*>(&r.length) + r.done;
+                    size = sizeof r.length - r.done;
+                } else {
+                    data = inbox[q].data() + (r.done - sizeof r.length);
+                    size = frame_size(r) - r.done;
+                }
+                if (size == 0)
+                    continue;
+                const ssize_t got = ::read(fd, data, size);
+                if (got == 0)
+                    closed();
+                if (got < 0 && errno != EAGAIN && errno != EINTR) {
+                    if (errno == ECONNRESET)
+                        closed();
+                    fail("cannot read from a partition process");
+                }
+                if (got > 0) {
+                    r.done += static_cast<std::size_t>(got);
+                    if (r.done == sizeof r.length)
+                        inbox[q].resize(r.length);
+                }
+            }
+        }
+    }
+    for (auto& box : outbox)
+        box.clear();
+}
+
+Coordinator::Coordinator(NodeId routers, const std::vector<std::uint32_t>& part, std::vector<Channel> workers,
+                         std::vector<pid_t> pids)
+    : routers_(routers)
+    , part_(part)
+    , workers_(std::move(workers))
+    , pids_(std::move(pids))
+    , printed_(routers)
+    , shown_(routers, 1)
+{
+}
+
+Coordinator::~Coordinator()
+{
+    for (const pid_t pid : pids_)
+        ::kill(pid, SIGTERM);
+    for (const pid_t pid : pids_)
+        ::waitpid(pid, nullptr, 0);
+}
+
+int Coordinator::converge(int t, TableOutput tables, OutputWriter& out)
+{
+    while (true) {
+        bool any = false;
+        std::fill(printed_.begin(), printed_.end(), 0);
+        for (Channel& worker : workers_) {
+            std::uint8_t changed = 0;
+            std::uint32_t count = 0;
+            worker.receive(&changed, sizeof changed);
+            worker.receive(&count, sizeof count);
+            for (std::uint32_t i = 0; i < count; ++i) {
+                NodeId x;
+                worker.receive(&x, sizeof x);
+                printed_[x] = 1;
+            }
+            any |= changed != 0;
+        }
+        const std::uint8_t go = any;
+        for (Channel& worker : workers_)
+            worker.send(&go, sizeof go);
+
+        const bool print = tables == TableOutput::all || tables == TableOutput::changed
+            || (tables == TableOutput::final && !any);
+        if (print) {
+            for (NodeId x = 0; x < routers_; ++x) {
+                if (shown_[x] && (tables != TableOutput::changed || printed_[x]))
+                    workers_[part_[x]].copy_lines(std::size_t(routers_) + 2, out);
+            }
+        }
+        if (!any)
+            return t;
+        ++t;
+    }
+}
+
+void Coordinator::print_routing_tables(OutputWriter& out)
+{
+    for (NodeId x = 0; x < routers_; ++x) {
+        if (shown_[x])
+            workers_[part_[x]].copy_lines(std::size_t(routers_) + 1, out);
+    }
+}
+
+void Coordinator::show_only(const std::vector<NodeId>& routers)
+{
+    std::fill(shown_.begin(), shown_.end(), 0);
+    for (const NodeId x : routers)
+        shown_[x] = 1;
+}
+
+void Coordinator::wait()
+{
+    workers_.clear();
+    bool failed = false;
+    for (const pid_t pid : pids_) {
+        int status = 0;
+        while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+        }
+        failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    pids_.clear();
+    if (failed)
+        throw std::runtime_error("a partition process failed");
+}
+
+Coordinator spawn_workers(NodeId routers, const std::vector<std::uint32_t>& part, unsigned parts,
+                          const std::function<int(WorkerLinks&)>& body)
+{
+    // to_coordinator[k] pairs worker k with this process; mesh[k][q] is
+    // worker k's end of its pair with worker q.
+    std::vector<int> all;
+    const auto pair = [&](int& a, int& b) {
+        int sv[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0)
+            fail("cannot connect partition processes");
+        a = sv[0];
+        b = sv[1];
+        all.push_back(a);
+        all.push_back(b);
+    };
+    std::vector<int> coordinator_end(parts), worker_end(parts);
+    std::vector<std::vector<int>> mesh(parts, std::vector<int>(parts, -1));
+    for (unsigned k = 0; k < parts; ++k)
+        pair(coordinator_end[k], worker_end[k]);
+    for (unsigned k = 0; k < parts; ++k) {
+        for (unsigned q = k + 1; q < parts; ++q)
+            pair(mesh[k][q], mesh[q][k]);
+    }
+
+    std::cout.flush();
+    std::vector<pid_t> pids;
+    for (std::uint32_t k = 0; k < parts; ++k) {
+        const pid_t pid = ::fork();
+        if (pid < 0)
+            fail("cannot start a partition process");
+        if (pid > 0) {
+            pids.push_back(pid);
+            continue;
+        }
+
+        int code = 1;
+        {
+            std::vector<int> mine{worker_end[k]};
+            for (unsigned q = 0; q < parts; ++q) {
+                if (q != k)
+                    mine.push_back(mesh[k][q]);
+            }
+            for (const int fd : all) {
+                if (std::find(mine.begin(), mine.end(), fd) == mine.end())
+                    ::close(fd);
+            }
+            std::vector<Channel> peers;
+            for (unsigned q = 0; q < parts; ++q)
+                peers.emplace_back(q == k ? -1 : mesh[k][q]);
+            try {
+                WorkerLinks links(k, part, Channel(worker_end[k]), std::move(peers));
+                code = body(links);
+                links.output().flush();
+            } catch (const std::exception& e) {
+                std::cerr << "DistanceVector: partition " << k << ": " << e.what() << '\n';
+            }
+        }
+        ::_exit(code);
+    }
+
+    for (unsigned k = 0; k < parts; ++k) {
+        ::close(worker_end[k]);
+        for (unsigned q = 0; q < parts; ++q) {
+            if (q != k)
+                ::close(mesh[k][q]);
+        }
+    }
+    std::vector<Channel> workers;
+    for (unsigned k = 0; k < parts; ++k)
+        workers.emplace_back(coordinator_end[k]);
+    return Coordinator(routers, part, std::move(workers), std::move(pids));
+}
+
+} // namespace dv
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "engine.hpp"
+#include "names.hpp"
+#include "output_writer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace dv {
+
+// Partitioned runs. A coordinator process reads the input and prints,
+// and one worker process per partition holds and computes only its own
+// routers' vectors, plus a ghost copy of each neighbour's vector that
+// lives in another partition. Every round, each worker
+//
+//   1. recomputes its dirty routers,
+//   2. tells the coordinator whether anything changed and which of its
+//      tables it will print, and learns whether any worker changed,
+//   3. writes its distance tables to the coordinator, which copies them
+//      through in router order, and
+//   4. sends every other worker one batched message with the entries
+//      that changed for the routers that worker keeps ghosts of.
+//
+// So the output is byte for byte that of a single process, while each
+// worker's tables take memory for its own and its ghost rows only.
+//
+// Processes are forked on this host and joined by socket pairs; messages
+// are in native byte order.
+
+// One end of a socket: blocking framed reads and writes, plus copying
+// whole lines of text through to an output writer.
+class Channel {
+public:
+    Channel() = default;
+    explicit Channel(int fd);
+    Channel(Channel&& other) noexcept;
+    Channel& operator=(Channel&& other) noexcept;
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+    ~Channel();
+
+    int fd() const { return fd_; }
+
+    // Both throw std::runtime_error if the other end has gone away.
+    void send(const void* data, std::size_t size);
+    void receive(void* data, std::size_t size);
+
+    // Copies the next lines newline-terminated lines to out.
+    void copy_lines(std::size_t lines, OutputWriter& out);
+
+private:
+    bool fill();
+
+    int fd_ = -1;
+    std::vector<char> buf_;
+    std::size_t begin_ = 0;
+    std::size_t end_ = 0;
+};
+
+// A worker's connections: to the coordinator, which also takes its
+// printed tables through output(), and to every other worker.
+class WorkerLinks {
+public:
+    // peers[self] is unused.
+    WorkerLinks(std::uint32_t self, const std::vector<std::uint32_t>& part, Channel coordinator,
+                std::vector<Channel> peers);
+
+    std::uint32_t self() const { return self_; }
+    unsigned parts() const { return static_cast<unsigned>(peers_.size()); }
+    // The partition of every router.
+    const std::uint32_t* part() const { return part_.data(); }
+
+    OutputWriter& output() { return out_; }
+
+    // Step 2 of a round: returns whether any worker's round changed a
+    // vector. printed lists this worker's routers whose distance tables
+    // it will print under TableOutput::changed.
+    bool report_round(bool changed, const std::vector<NodeId>& printed);
+
+    // Sends outbox[q] to every other worker q and fills inbox[q] with what
+    // q sent, all at once so no pair waits on another; every worker must
+    // call it together.
+    void exchange(std::vector<std::vector<char>>& outbox, std::vector<std::vector<char>>& inbox);
+
+private:
+    std::uint32_t self_;
+    const std::vector<std::uint32_t>& part_;
+    Channel coordinator_;
+    std::vector<Channel> peers_;
+    OutputWriter out_;
+};
+
+// The coordinator's side: mirrors the workers' rounds and merges their
+// output.
+class Coordinator {
+public:
+    Coordinator(NodeId routers, const std::vector<std::uint32_t>& part, std::vector<Channel> workers,
+                std::vector<pid_t> pids);
+    Coordinator(Coordinator&&) = default;
+    // Stops any worker still running.
+    ~Coordinator();
+
+    // Runs the rounds of an Engine::converge() call on the workers,
+    // printing what they print; returns the last round.
+    int converge(int t, TableOutput tables, OutputWriter& out);
+    void print_routing_tables(OutputWriter& out);
+    // Expects tables from these routers only, as the workers print for
+    // EngineConfig::query.
+    void show_only(const std::vector<NodeId>& routers);
+
+    // Waits for every worker to exit; throws std::runtime_error if one
+    // failed.
+    void wait();
+
+private:
+    NodeId routers_;
+    const std::vector<std::uint32_t>& part_;
+    std::vector<Channel> workers_;
+    std::vector<pid_t> pids_;
+    std::vector<std::uint8_t> printed_;
+    std::vector<std::uint8_t> shown_;
+};
+
+// Forks one worker per partition, connected to each other and to the
+// calling process, which becomes the coordinator. A worker runs body and
+// exits with its result, or with 1 if it throws.
+Coordinator spawn_workers(NodeId routers, const std::vector<std::uint32_t>& part, unsigned parts,
+                          const std::function<int(WorkerLinks&)>& body);
+
+} // namespace dv
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+namespace dv {
+
+// Link and path costs. Unreachable is a sentinel rather than a separate
+// flag so tables stay plain int32 arrays; it is small enough that adding
+// any link cost to it cannot overflow, and any path at or above it counts
+// as unreachable.
+using Cost = std::int32_t;
+constexpr Cost kInfinity = 0x3fffffff;
+constexpr Cost kMaxLinkCost = kInfinity - 1;
+
+// Table entries for compact tables: half the size, with the top value as
+// the unreachable sentinel and sums saturating into it. A finite path
+// cost that does not fit overflows, which the engine detects and answers
+// by switching to Cost tables.
+using CompactCost = std::uint16_t;
+constexpr CompactCost kCompactInfinity = 0xffff;
+
+// An entry of either kind as a Cost, and back.
+constexpr Cost widen(Cost d) { return d; }
+constexpr Cost widen(CompactCost d) { return d == kCompactInfinity ? kInfinity : d; }
+
+template <typename Entry>
+constexpr Entry narrow(Cost d);
+template <>
+constexpr Cost narrow<Cost>(Cost d)
+{
+    return d;
+}
+// d must be unreachable or below kCompactInfinity.
+template <>
+constexpr CompactCost narrow<CompactCost>(Cost d)
+{
+    return d >= kInfinity ? kCompactInfinity : static_cast<CompactCost>(d);
+}
+
+// The unreachable sentinel of an entry type.
+template <typename Entry>
+constexpr Entry kUnreachable = narrow<Entry>(kInfinity);
+
+} // namespace dv
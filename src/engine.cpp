@@ -0,0 +1,1572 @@
+#include "engine.hpp"
+
+#include "cluster.hpp"
+#include "instrument.hpp"
+#include "partition.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+namespace dv {
+
+namespace {
+
+// Cells are left-justified to four characters plus a separator, like the
+// reference; end_line() strips the padding after the last one.
+void pad(OutputWriter& out, std::size_t width)
+{
+    out.spaces(width < 4 ? 5 - width : 1);
+}
+
+void cell(OutputWriter& out, std::string_view text)
+{
+    out.write(text);
+    pad(out, text.size());
+}
+
+void cost_cell(OutputWriter& out, Cost cost, Cost infinity)
+{
+    if (cost >= infinity)
+        cell(out, "INF");
+    else
+        pad(out, out.write_uint(static_cast<std::uint32_t>(cost)));
+}
+
+template <typename T>
+void append(std::vector<char>& box, const T& value)
+{
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    box.insert(box.end(), bytes, bytes + sizeof value);
+}
+
+// One binary delta record; see Engine::write_deltas().
+void write_record(OutputWriter& out, const std::array<std::uint32_t, 6>& fields)
+{
+    unsigned char bytes[sizeof fields];
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+        for (std::size_t b = 0; b < 4; ++b)
+            bytes[i * 4 + b] = static_cast<unsigned char>(fields[i] >> (8 * b));
+    }
+    out.write_bytes(bytes, sizeof bytes);
+}
+
+void json_string(OutputWriter& out, std::string_view text)
+{
+    static constexpr char kHex[] = "0123456789abcdef";
+    out.put('"');
+    for (const char c : text) {
+        const auto u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out.put('\\');
+            out.put(c);
+        } else if (u < 0x20) {
+            out.write("\\u00");
+            out.put(kHex[u >> 4]);
+            out.put(kHex[u & 15]);
+        } else {
+            out.put(c);
+        }
+    }
+    out.put('"');
+}
+
+void json_cost(OutputWriter& out, Cost cost, Cost infinity)
+{
+    if (cost >= infinity)
+        out.write("null");
+    else
+        out.write_uint(static_cast<std::uint32_t>(cost));
+}
+
+template <typename T>
+T take(const char*& p)
+{
+    T value;
+    std::memcpy(&value, p, sizeof value);
+    p += sizeof value;
+    return value;
+}
+
+} // namespace
+
+template <typename Policy>
+Engine<Policy>::Engine(const Topology& topo, const EngineConfig& config, Snapshot snapshot)
+    : names_(topo.names)
+    , config_(config)
+    , net_(topo.names.size())
+    , kernels_(relax_kernels())
+    , snapshot_(std::move(snapshot))
+{
+    const NodeId n = net_.node_count();
+    rank_ = topo.rank;
+    if (rank_.empty()) {
+        rank_.resize(n);
+        for (NodeId x = 0; x < n; ++x)
+            rank_[x] = x;
+    } else {
+        net_.rank_neighbours(rank_);
+    }
+    order_.resize(n);
+    for (NodeId x = 0; x < n; ++x)
+        order_[rank_[x]] = x;
+
+    for (const auto& link : topo.links)
+        net_.set_link(link.a, link.b, link.cost);
+    net_.build(scratch_);
+    scratch_.reset();
+
+    const bool warm = snapshot_.dist() != nullptr;
+    window_.assign(n, whole_row());
+    windowed_ = !warm && config_.cluster == nullptr;
+    if (config_.stop_counting || windowed_)
+        label_components();
+    if (windowed_) {
+        window_.assign(n, {whole_row().end, 0});
+        update_windows();
+        windowed_ = stored_entries() < std::uint64_t{n} * RouteMatrix::stride_for(n);
+    }
+    current_.assign(n, 0);
+    if (!config_.table_dir.empty()) {
+        table_file_ = std::make_unique<TableFile>(config_.table_dir);
+        const std::size_t row_bytes = RouteMatrix::stride_for(n) * sizeof(Cost);
+        tile_rows_ = static_cast<NodeId>(std::max<std::size_t>(1, kTileBytes / row_bytes));
+    }
+    pending_ = BitRows(n, n, table_file_.get());
+    stale_ = BitRows(n, n, table_file_.get());
+    full_.assign(n, 0);
+    is_dirty_.assign(n, 0);
+    table_changed_.assign(n, 0);
+    if (config_.format != OutputFormat::text)
+        config_.tables = TableOutput::none;
+    shown_.assign(n, config_.query.empty());
+    for (const NodeId x : config_.query)
+        shown_[x] = 1;
+    if (config_.cluster != nullptr) {
+        part_ = config_.cluster->part();
+        self_ = config_.cluster->self();
+        is_ghost_.assign(n, 0);
+        outbox_.resize(config_.cluster->parts());
+        inbox_.resize(config_.cluster->parts());
+        queued_for_.assign(config_.cluster->parts(), 0);
+    }
+    if (warm) {
+        // The spare rows start out as garbage, so every entry is stale;
+        // a router's first recomputation then writes its whole row.
+        tables_[0] = RouteMatrix::borrow(n, snapshot_.dist(), snapshot_.via());
+        if (table_file_) {
+            tables_[1] = RouteMatrix::sparse(n, table_file_.get());
+            for (NodeId x = 0; x < n; ++x)
+                tables_[1].clear_row(x, n, tables_[1].stride());
+        } else {
+            tables_[1] = RouteMatrix::uninitialized(n);
+        }
+        for (NodeId x = 0; x < n; ++x)
+            stale_.fill_row(x);
+    } else {
+        compact_ = config_.compact;
+        if (compact_)
+            init_tables<CompactCost>();
+        else
+            init_tables<Cost>();
+        for (NodeId x = 0; x < n; ++x) {
+            if (owns(x))
+                touch(x);
+        }
+    }
+
+    unsigned threads = config_.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    pool_ = std::make_unique<ThreadPool>(threads);
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::init_tables()
+{
+    const NodeId n = net_.node_count();
+    BasicRouteMatrix<Entry>* buffers = tables<Entry>();
+    if (part_ == nullptr) {
+        const bool sparse = windowed_ || table_file_;
+        for (int i = 0; i < 2; ++i)
+            buffers[i] = sparse ? BasicRouteMatrix<Entry>::sparse(n, table_file_.get()) : BasicRouteMatrix<Entry>(n);
+        for (NodeId x = 0; x < n; ++x) {
+            if (sparse) {
+                for (int i = 0; i < 2; ++i)
+                    buffers[i].clear_row(x, window_[x].begin, window_end<Entry>(x));
+            }
+            buffers[0].dist(x)[x] = 0;
+            buffers[0].via(x)[x] = x;
+        }
+        return;
+    }
+
+    // Rows are committed on first write, so a worker's tables take memory
+    // for its own routers and their ghosts only.
+    for (int i = 0; i < 2; ++i)
+        buffers[i] = BasicRouteMatrix<Entry>::sparse(n, table_file_.get());
+    const NodeId* targets = net_.targets();
+    for (NodeId x = 0; x < n; ++x) {
+        if (!owns(x))
+            continue;
+        buffers[1].clear_row(x);
+        init_ghost_row<Entry>(x);
+        for (auto e = net_.offset(x), end = net_.offset(x + 1); e < end; ++e) {
+            if (!owns(targets[e]) && !is_ghost_[targets[e]])
+                init_ghost_row<Entry>(targets[e]);
+        }
+    }
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::init_ghost_row(NodeId v)
+{
+    BasicRouteMatrix<Entry>& rows = tables<Entry>()[0];
+    rows.clear_row(v);
+    rows.dist(v)[v] = 0;
+    rows.via(v)[v] = v;
+    if (!owns(v))
+        is_ghost_[v] = 1;
+}
+
+template <typename Policy>
+void Engine<Policy>::widen_tables()
+{
+    if (!compact_)
+        return;
+    const NodeId n = net_.node_count();
+    for (int i = 0; i < 2; ++i) {
+        // Cluster, windowed and file rows are sparse; only owned rows, and
+        // ghosts in the first buffer, hold anything, and only within windows.
+        const bool sparse = part_ != nullptr || windowed_ || table_file_;
+        tables_[i] = sparse ? RouteMatrix::sparse(n, table_file_.get()) : RouteMatrix::uninitialized(n);
+        for (NodeId x = 0; x < n; ++x) {
+            if (!owns(x) && !(i == 0 && is_ghost_[x]))
+                continue;
+            const std::size_t begin = window_[x].begin;
+            const std::size_t end = std::min<std::size_t>(window_[x].end, n);
+            if (sparse)
+                tables_[i].clear_row(x, begin, window_end<Cost>(x));
+            const CompactCost* from = compact_tables_[i].dist(x);
+            Cost* to = tables_[i].dist(x);
+            for (std::size_t y = begin; y < end; ++y)
+                to[y] = widen(from[y]);
+            std::copy(compact_tables_[i].via(x) + begin, compact_tables_[i].via(x) + end, tables_[i].via(x) + begin);
+        }
+        compact_tables_[i] = CompactRouteMatrix();
+    }
+    compact_ = false;
+}
+
+template <typename Policy>
+void Engine<Policy>::update_windows()
+{
+    const NodeId n = net_.node_count();
+    const Window whole = whole_row();
+    std::vector<Window> span(component_count_, Window{whole.end, 0});
+    for (NodeId x = 0; x < n; ++x) {
+        Window& s = span[component_[x]];
+        s.begin = std::min({s.begin, std::size_t{x}, window_[x].begin});
+        s.end = std::max({s.end, std::size_t{x} + 1, window_[x].end});
+    }
+    for (Window& s : span) {
+        s.begin = s.begin / kWindowAlign * kWindowAlign;
+        s.end = std::min(whole.end, (s.end + kWindowAlign - 1) / kWindowAlign * kWindowAlign);
+        if ((s.end - s.begin) * 4 >= whole.end * 3)
+            s = whole;
+    }
+    // Only merged components grow; their new entries start unreachable.
+    const bool allocated = compact_ ? compact_tables_[0].rows() != 0 : tables_[0].rows() != 0;
+    for (NodeId x = 0; x < n; ++x) {
+        const Window& to = span[component_[x]];
+        if (to.begin == window_[x].begin && to.end == window_[x].end)
+            continue;
+        if (allocated && compact_)
+            grow_window<CompactCost>(x, to);
+        else if (allocated)
+            grow_window<Cost>(x, to);
+        window_[x] = to;
+    }
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::grow_window(NodeId x, const Window& to)
+{
+    const Window& from = window_[x];
+    for (int i = 0; i < 2; ++i) {
+        BasicRouteMatrix<Entry>& rows = tables<Entry>()[i];
+        const std::size_t stride = rows.stride();
+        rows.clear_row(x, to.begin, std::min(from.begin, stride));
+        rows.clear_row(x, std::min(from.end, stride), std::min(to.end, stride));
+    }
+}
+
+template <typename Policy>
+void Engine<Policy>::make_dense()
+{
+    if (!windowed_)
+        return;
+    if (compact_)
+        grow_windows<CompactCost>();
+    else
+        grow_windows<Cost>();
+    windowed_ = false;
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::grow_windows()
+{
+    for (NodeId x = 0; x < net_.node_count(); ++x) {
+        grow_window<Entry>(x, whole_row());
+        window_[x] = whole_row();
+    }
+}
+
+template <typename Policy>
+std::uint64_t Engine<Policy>::stored_entries() const
+{
+    const NodeId n = net_.node_count();
+    const std::size_t stride = compact_ ? CompactRouteMatrix::stride_for(n) : RouteMatrix::stride_for(n);
+    std::uint64_t stored = 0;
+    for (const Window& w : window_)
+        stored += std::min(w.end, stride) - std::min(w.begin, stride);
+    return stored;
+}
+
+template <typename Policy>
+void Engine<Policy>::mark_dirty(NodeId x)
+{
+    if (!is_dirty_[x]) {
+        is_dirty_[x] = 1;
+        dirty_.push_back(x);
+    }
+}
+
+template <typename Policy>
+void Engine<Policy>::touch(NodeId x)
+{
+    mark_dirty(x);
+    full_[x] = 1;
+    table_changed_[x] = 1;
+}
+
+template <typename Policy>
+void Engine<Policy>::mark_all_dirty()
+{
+    for (NodeId x = 0; x < net_.node_count(); ++x) {
+        if (owns(x)) {
+            mark_dirty(x);
+            full_[x] = 1;
+        }
+    }
+}
+
+template <typename Policy>
+template <typename Entry>
+typename Engine<Policy>::RowChange Engine<Policy>::compute(NodeId x)
+{
+    const bool saturated = compute_range<Entry>(x, whole_row_pass(x), window_[x].begin, window_end<Entry>(x));
+    return finish_row<Entry>(x, saturated);
+}
+
+template <typename Policy>
+bool Engine<Policy>::whole_row_pass(NodeId x) const
+{
+    return full_[x] || stale_.count(pending_.row(x)) * kSparseRatio > net_.node_count();
+}
+
+template <typename Policy>
+template <typename Entry>
+bool Engine<Policy>::compute_range(NodeId x, bool whole, std::size_t begin, std::size_t end)
+{
+    constexpr bool compact = std::is_same_v<Entry, CompactCost>;
+    const NodeId* targets = net_.targets();
+    const Cost* costs = net_.costs();
+
+    BasicRouteMatrix<Entry>& next = spare<Entry>(x);
+    const BasicRouteMatrix<Entry>& prev = current<Entry>(x);
+    Entry* dist = next.dist(x);
+    NodeId* via = next.via(x);
+    const Entry* old_dist = prev.dist(x);
+    const NodeId* old_via = prev.via(x);
+    BitRows::Word* stale = stale_.row(x);
+    const BitRows::Word* pending = pending_.row(x);
+    const std::size_t first_word = begin / BitRows::kWordBits;
+    const std::size_t last_word = (end + BitRows::kWordBits - 1) / BitRows::kWordBits;
+    const auto first = net_.offset(x), last = net_.offset(x + 1);
+    bool saturated = false;
+
+    if (whole) {
+        // Min-plus passes over the range, then a scan for what changed.
+        const std::size_t span = end - begin;
+        next.clear_row(x, begin, end);
+        DV_COUNT(relaxations, std::uint64_t{net_.degree(x)} * span);
+        Entry* const to = dist + begin;
+        NodeId* const hops = via + begin;
+        for (auto e = first; e < last; ++e) {
+            const NodeId v = targets[e];
+            const BasicRouteMatrix<Entry>& adv = neighbour_row<Entry>(x, v);
+            const Entry* from = adv.dist(v) + begin;
+            const NodeId* from_via = adv.via(v) + begin;
+            if constexpr (compact && Policy::kPoisons)
+                saturated |= kernels_.compact_poisoned(to, hops, from, from_via, costs[e], v, x, span);
+            else if constexpr (compact)
+                saturated |= kernels_.compact_plain(to, hops, from, costs[e], v, span);
+            else if constexpr (Policy::kPoisons)
+                kernels_.poisoned(to, hops, from, from_via, costs[e], v, x, span);
+            else
+                kernels_.plain(to, hops, from, costs[e], v, span);
+        }
+        if (config_.infinity < kInfinity) {
+            for (std::size_t y = 0; y < span; ++y) {
+                if (to[y] >= config_.infinity) {
+                    to[y] = kUnreachable<Entry>;
+                    hops[y] = kNoNode;
+                }
+            }
+        }
+        if (x >= begin && x < end) {
+            dist[x] = 0;
+            via[x] = x;
+        }
+        if constexpr (compact)
+            kernels_.compact_diff(to, hops, old_dist + begin, old_via + begin, stale + first_word, span);
+        else
+            kernels_.diff(to, hops, old_dist + begin, old_via + begin, stale + first_word, span);
+        return saturated;
+    }
+
+    // Bring the spare row level with the current one, then redo only the
+    // destinations a neighbour's vector changed for.
+    BitRows::for_each(stale, first_word, last_word, [&](std::size_t y) {
+        dist[y] = old_dist[y];
+        via[y] = old_via[y];
+    });
+    std::fill(stale + first_word, stale + last_word, 0);
+    DV_COUNT(relaxations, std::uint64_t{net_.degree(x)} * BitRows::count(pending, first_word, last_word));
+    BitRows::for_each(pending, first_word, last_word, [&](std::size_t y) {
+        if (y == x)
+            return;
+        Cost best = kInfinity;
+        NodeId hop = kNoNode;
+        for (auto e = first; e < last; ++e) {
+            const NodeId v = targets[e];
+            const BasicRouteMatrix<Entry>& adv = neighbour_row<Entry>(x, v);
+            const Cost d = costs[e] + advertised<Policy>(widen(adv.dist(v)[y]), adv.via(v)[y], x);
+            if (d < best) {
+                best = d;
+                hop = v;
+            }
+        }
+        if (best >= config_.infinity) {
+            best = kInfinity;
+            hop = kNoNode;
+        } else if (compact && best >= kCompactInfinity) {
+            saturated = true;
+            best = kInfinity;
+        }
+        dist[y] = narrow<Entry>(best);
+        via[y] = hop;
+        if (best != widen(old_dist[y]) || hop != old_via[y])
+            BitRows::set(stale, y);
+    });
+    return saturated;
+}
+
+template <typename Policy>
+template <typename Entry>
+typename Engine<Policy>::RowChange Engine<Policy>::finish_row(NodeId x, bool saturated)
+{
+    const BitRows::Word* stale = stale_.row(x);
+    pending_.clear_row(x);
+    full_[x] = 0;
+
+    RowChange change{x};
+    // Saturating at or above the bound is just unreachable.
+    change.overflow = saturated && config_.infinity > kCompactInfinity;
+    change.changed = stale_.any(stale);
+    DV_COUNT(entries_changed, stale_.count(stale));
+
+    if (can_stop_counting_ && change.changed) {
+        stale_.for_each(stale, [&](std::size_t y) {
+            if (component_[y] == component_[x])
+                change.cut_off_only = false;
+        });
+    }
+    return change;
+}
+
+template <typename Policy>
+void Engine<Policy>::commit(const RowChange& change)
+{
+    // A router's next vector depends only on its links and its
+    // neighbours' vectors, so only neighbours of changed routers need
+    // another look.
+    const NodeId x = change.router;
+    if (compact_)
+        observe_commit<CompactCost>(x);
+    else
+        observe_commit<Cost>(x);
+    current_[x] ^= 1;
+    stats_.advertisements += net_.degree(x);
+    DV_COUNT(advertisements, net_.degree(x));
+
+    // After the flip the spare row is the old vector, so the stale bits
+    // are exactly the entries the neighbours need to recompute.
+    const BitRows::Word* changed = stale_.row(x);
+    const NodeId* targets = net_.targets();
+    for (auto e = net_.offset(x), end = net_.offset(x + 1); e < end; ++e) {
+        const NodeId v = targets[e];
+        if (!owns(v))
+            continue;
+        mark_dirty(v);
+        BitRows::Word* pending = pending_.row(v);
+        for (std::size_t w = 0; w < stale_.words(); ++w)
+            pending[w] |= changed[w];
+    }
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::observe_commit(NodeId x)
+{
+    if (config_.tables == TableOutput::changed)
+        mark_changed_views<Entry>(x);
+    if (recording_ && shown_[x])
+        log_route_changes<Entry>(x, route_log_);
+    if (config_.format != OutputFormat::text && shows(x))
+        log_deltas<Entry>(x);
+    if (part_ != nullptr)
+        send_row_changes<Entry>(x);
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::send_row_changes(NodeId x)
+{
+    // Called before the flip: the new vector is still the spare row.
+    const Entry* dist = spare<Entry>(x).dist(x);
+    const NodeId* via = spare<Entry>(x).via(x);
+    const BitRows::Word* stale = stale_.row(x);
+    const NodeId* targets = net_.targets();
+    std::fill(queued_for_.begin(), queued_for_.end(), 0);
+    for (auto e = net_.offset(x), end = net_.offset(x + 1); e < end; ++e) {
+        const std::uint32_t q = part_[targets[e]];
+        if (q == self_ || queued_for_[q])
+            continue;
+        queued_for_[q] = 1;
+        std::vector<char>& box = outbox_[q];
+        append(box, x);
+        append(box, static_cast<std::uint32_t>(stale_.count(stale)));
+        stale_.for_each(stale, [&](std::size_t y) {
+            append(box, GhostEntry{static_cast<NodeId>(y), widen(dist[y]), via[y]});
+        });
+    }
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::send_row(NodeId x, std::uint32_t to)
+{
+    const NodeId n = net_.node_count();
+    const Entry* dist = current<Entry>(x).dist(x);
+    const NodeId* via = current<Entry>(x).via(x);
+    std::vector<char>& box = outbox_[to];
+    append(box, x);
+    append(box, static_cast<std::uint32_t>(n));
+    for (NodeId y = 0; y < n; ++y)
+        append(box, GhostEntry{y, widen(dist[y]), via[y]});
+}
+
+template <typename Policy>
+void Engine<Policy>::exchange_ghost_rows()
+{
+    DV_SCOPE("exchange ghost rows");
+    config_.cluster->exchange(outbox_, inbox_);
+    // A worker that has widened its tables can send costs that compact
+    // ones cannot hold.
+    if (compact_) {
+        for (const auto& records : inbox_) {
+            if (!fits_compact(records)) {
+                widen_tables();
+                stats_.widened = true;
+                break;
+            }
+        }
+    }
+    for (const auto& records : inbox_) {
+        if (compact_)
+            apply_ghost_rows<CompactCost>(records);
+        else
+            apply_ghost_rows<Cost>(records);
+    }
+}
+
+template <typename Policy>
+bool Engine<Policy>::fits_compact(const std::vector<char>& records)
+{
+    const char* p = records.data();
+    const char* end = p + records.size();
+    while (p < end) {
+        take<NodeId>(p);
+        const auto count = take<std::uint32_t>(p);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            const auto entry = take<GhostEntry>(p);
+            if (entry.dist >= kCompactInfinity && entry.dist < kInfinity)
+                return false;
+        }
+    }
+    return true;
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::apply_ghost_rows(const std::vector<char>& records)
+{
+    const NodeId* targets = net_.targets();
+    const Cost* costs = net_.costs();
+    const Cost infinity = config_.infinity;
+    const bool track_views = config_.tables == TableOutput::changed;
+    const char* p = records.data();
+    const char* end = p + records.size();
+    while (p < end) {
+        const auto v = take<NodeId>(p);
+        const auto count = take<std::uint32_t>(p);
+        // A router first seen as a ghost here only has new links to this
+        // partition's routers, which are already marked changed.
+        const bool fresh = !is_ghost_[v];
+        if (fresh)
+            init_ghost_row<Entry>(v);
+        Entry* dist = tables<Entry>()[0].dist(v);
+        NodeId* via = tables<Entry>()[0].via(v);
+        const auto first = net_.offset(v), last = net_.offset(v + 1);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            const auto entry = take<GhostEntry>(p);
+            const NodeId y = entry.dest;
+            if (entry.dist == widen(dist[y]) && entry.via == via[y])
+                continue;
+            // The same bookkeeping commit() does for a local neighbour.
+            for (auto e = first; e < last; ++e) {
+                const NodeId w = targets[e];
+                if (!owns(w))
+                    continue;
+                mark_dirty(w);
+                BitRows::set(pending_.row(w), y);
+                if (track_views && !fresh && shown_[w] && !table_changed_[w] && y != w) {
+                    const Cost before
+                        = std::min(costs[e] + advertised<Policy>(widen(dist[y]), via[y], w), infinity);
+                    const Cost after = std::min(costs[e] + advertised<Policy>(entry.dist, entry.via, w), infinity);
+                    if (before != after)
+                        table_changed_[w] = 1;
+                }
+            }
+            dist[y] = narrow<Entry>(entry.dist);
+            via[y] = entry.via;
+        }
+    }
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::log_route_changes(NodeId x, std::vector<LoggedRoute>& log)
+{
+    const Entry* dist = current<Entry>(x).dist(x);
+    const NodeId* via = current<Entry>(x).via(x);
+    BitRows::Word* logged = logged_.row(x);
+    stale_.for_each(stale_.row(x), [&](std::size_t y) {
+        if (!BitRows::test(logged, y)) {
+            BitRows::set(logged, y);
+            log.push_back({x, static_cast<NodeId>(y), widen(dist[y]), via[y]});
+        }
+    });
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::log_deltas(NodeId x)
+{
+    // Called before the flip: the current row is the old vector.
+    const Entry* old_dist = current<Entry>(x).dist(x);
+    const NodeId* old_via = current<Entry>(x).via(x);
+    const Entry* dist = spare<Entry>(x).dist(x);
+    const NodeId* via = spare<Entry>(x).via(x);
+    stale_.for_each(stale_.row(x), [&](std::size_t y) {
+        deltas_.push_back({x, static_cast<NodeId>(y), widen(old_dist[y]), old_via[y], widen(dist[y]), via[y]});
+    });
+}
+
+template <typename Policy>
+void Engine<Policy>::write_deltas(int t, OutputWriter& out)
+{
+    DV_SCOPE("write deltas");
+    std::stable_sort(deltas_.begin(), deltas_.end(), [&](const RouteDelta& a, const RouteDelta& b) {
+        return a.router != b.router ? rank_[a.router] < rank_[b.router] : rank_[a.dest] < rank_[b.dest];
+    });
+    // A cut count is committed between rounds, so a route can change
+    // again in the round that follows.
+    std::size_t kept = 0;
+    for (const RouteDelta& d : deltas_) {
+        if (kept != 0 && deltas_[kept - 1].router == d.router && deltas_[kept - 1].dest == d.dest) {
+            deltas_[kept - 1].dist = d.dist;
+            deltas_[kept - 1].via = d.via;
+        } else {
+            deltas_[kept++] = d;
+        }
+    }
+    deltas_.resize(kept);
+
+    const Cost infinity = config_.infinity;
+    for (const RouteDelta& d : deltas_) {
+        if (d.dist == d.old_dist && d.via == d.old_via)
+            continue;
+        if (config_.format == OutputFormat::binary) {
+            const auto cost = [&](Cost c) { return c >= infinity ? ~std::uint32_t{0} : static_cast<std::uint32_t>(c); };
+            const auto id = [&](NodeId v) { return v == kNoNode ? ~std::uint32_t{0} : rank_[v]; };
+            write_record(out, {static_cast<std::uint32_t>(t), rank_[d.router], rank_[d.dest], cost(d.old_dist),
+                               cost(d.dist), id(d.via)});
+            continue;
+        }
+        out.write("{\"round\":");
+        out.write_int(t);
+        out.write(",\"router\":");
+        json_string(out, names_.name(d.router));
+        out.write(",\"dest\":");
+        json_string(out, names_.name(d.dest));
+        out.write(",\"old\":");
+        json_cost(out, d.old_dist, infinity);
+        out.write(",\"new\":");
+        json_cost(out, d.dist, infinity);
+        out.write(",\"via\":");
+        if (d.via == kNoNode || d.dist >= infinity)
+            out.write("null");
+        else
+            json_string(out, names_.name(d.via));
+        out.put('}');
+        out.end_line();
+    }
+    deltas_.clear();
+}
+
+template <typename Policy>
+void Engine<Policy>::write_converged(int t, OutputWriter& out) const
+{
+    if (config_.format == OutputFormat::binary) {
+        write_record(out, {static_cast<std::uint32_t>(t), ~std::uint32_t{0}, ~std::uint32_t{0}, ~std::uint32_t{0},
+                           ~std::uint32_t{0}, ~std::uint32_t{0}});
+        return;
+    }
+    out.write("{\"round\":");
+    out.write_int(t);
+    out.write(",\"converged\":true}");
+    out.end_line();
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::mark_changed_views(NodeId x)
+{
+    const BasicRouteMatrix<Entry>& old_row = current<Entry>(x);
+    const BasicRouteMatrix<Entry>& new_row = spare<Entry>(x);
+    const Entry* old_dist = old_row.dist(x);
+    const NodeId* old_via = old_row.via(x);
+    const Entry* new_dist = new_row.dist(x);
+    const NodeId* new_via = new_row.via(x);
+    const NodeId* targets = net_.targets();
+    const Cost* costs = net_.costs();
+    const Cost infinity = config_.infinity;
+    // Compare what w's table shows, so a cost that stays at or above
+    // infinity counts as unchanged; w's own column entry is always the
+    // link cost.
+    for (auto e = net_.offset(x), end = net_.offset(x + 1); e < end; ++e) {
+        const NodeId w = targets[e];
+        if (table_changed_[w] || !shows(w))
+            continue;
+        stale_.for_each(stale_.row(x), [&](std::size_t y) {
+            const Cost before
+                = std::min(costs[e] + advertised<Policy>(widen(old_dist[y]), old_via[y], w), infinity);
+            const Cost after
+                = std::min(costs[e] + advertised<Policy>(widen(new_dist[y]), new_via[y], w), infinity);
+            if (y != w && before != after)
+                table_changed_[w] = 1;
+        });
+    }
+}
+
+template <typename Policy>
+int Engine<Policy>::converge(int t, OutputWriter& out)
+{
+    while (true) {
+        DV_SCOPE_ARG("round", t);
+        if (!config_.incremental)
+            mark_all_dirty();
+        ++stats_.rounds;
+        stats_.evaluations += dirty_.size();
+
+        if (compact_)
+            compute_round<CompactCost>();
+        else
+            compute_round<Cost>();
+        if (std::any_of(changes_, changes_ + dirty_.size(), [](const RowChange& c) { return c.overflow; })) {
+            // A cost outgrew the compact tables: redo the round in full
+            // width, from the previous round's vectors.
+            widen_tables();
+            stats_.widened = true;
+            for (const NodeId x : dirty_)
+                full_[x] = 1;
+            compute_round<Cost>();
+        }
+        const std::size_t change_count = dirty_.size();
+        dirty_.clear();
+
+        bool any_changed = false;
+        bool cut_off_only = can_stop_counting_;
+        for (std::size_t i = 0; i < change_count; ++i) {
+            if (changes_[i].changed) {
+                any_changed = true;
+                cut_off_only = cut_off_only && changes_[i].cut_off_only;
+            }
+        }
+        if (config_.cluster != nullptr) {
+            printed_.clear();
+            if (config_.tables == TableOutput::changed) {
+                for (NodeId x = 0; x < net_.node_count(); ++x) {
+                    if (shows(x) && table_changed_[x])
+                        printed_.push_back(x);
+                }
+            }
+            any_changed = config_.cluster->report_round(any_changed, printed_);
+        }
+
+        switch (config_.tables) {
+        case TableOutput::all:
+        case TableOutput::changed:
+            print_distance_tables(t, out);
+            break;
+        case TableOutput::final:
+            if (!any_changed)
+                print_distance_tables(t, out);
+            break;
+        case TableOutput::none:
+            break;
+        }
+        std::fill(table_changed_.begin(), table_changed_.end(), 0);
+        // The coordinator may not read other workers' tables until this
+        // one's are out, and they are about to wait on each other.
+        if (config_.cluster != nullptr)
+            out.flush();
+
+        for (std::size_t i = 0; i < change_count; ++i) {
+            if (changes_[i].changed)
+                commit(changes_[i]);
+        }
+        if (config_.format != OutputFormat::text) {
+            write_deltas(t, out);
+            if (!any_changed)
+                write_converged(t, out);
+        }
+        if (!any_changed)
+            return t;
+        if (config_.cluster != nullptr)
+            exchange_ghost_rows();
+        if (cut_off_only && (compact_ ? cut_count_to_infinity<CompactCost>() : cut_count_to_infinity<Cost>()))
+            ++stats_.counts_stopped;
+        ++t;
+    }
+}
+
+template <typename Policy>
+template <typename Entry>
+bool Engine<Policy>::cut_count_to_infinity()
+{
+    const NodeId n = net_.node_count();
+    const Cost* costs = net_.costs();
+
+    // Every route still counting in a component rises by at least the
+    // component's cheapest link per round, so the slowest one there
+    // bounds the rounds left.
+    Cost* lowest = scratch_.allocate_array<Cost>(component_count_);
+    Cost* cheapest = scratch_.allocate_array<Cost>(component_count_);
+    std::fill_n(lowest, component_count_, kInfinity);
+    std::fill_n(cheapest, component_count_, kInfinity);
+    for (NodeId x = 0; x < n; ++x) {
+        const NodeId c = component_[x];
+        const Entry* dist = current<Entry>(x).dist(x);
+        for (NodeId y = window_[x].begin, end = std::min<std::size_t>(window_[x].end, n); y < end; ++y) {
+            if (widen(dist[y]) < lowest[c] && component_[y] != c)
+                lowest[c] = widen(dist[y]);
+        }
+        for (auto e = net_.offset(x), end = net_.offset(x + 1); e < end; ++e)
+            cheapest[c] = std::min(cheapest[c], costs[e]);
+    }
+    std::uint64_t rounds = 0;
+    for (NodeId c = 0; c < component_count_; ++c) {
+        if (lowest[c] < kInfinity) {
+            const std::uint64_t rise = config_.infinity - lowest[c];
+            rounds = std::max<std::uint64_t>(rounds, (rise + cheapest[c] - 1) / cheapest[c]);
+        }
+    }
+    scratch_.reset();
+    if (rounds == 0)
+        return false;
+    stats_.rounds_skipped += rounds;
+    stats_.looping_routes += count_looping_routes();
+
+    // Commit the cut rows like a round's results, so the next round sees
+    // them and --tables changed still prints exactly the changed tables.
+    for (NodeId x = 0; x < n; ++x) {
+        const NodeId c = component_[x];
+        const Entry* dist = current<Entry>(x).dist(x);
+        const NodeId* via = current<Entry>(x).via(x);
+        BasicRouteMatrix<Entry>& next = spare<Entry>(x);
+        Entry* next_dist = next.dist(x);
+        NodeId* next_via = next.via(x);
+        BitRows::Word* stale = stale_.row(x);
+        stale_.clear_row(x);
+        RowChange change{x};
+        for (NodeId y = window_[x].begin, end = std::min<std::size_t>(window_[x].end, n); y < end; ++y) {
+            const bool cut = dist[y] != kUnreachable<Entry> && component_[y] != c;
+            next_dist[y] = cut ? kUnreachable<Entry> : dist[y];
+            next_via[y] = cut ? kNoNode : via[y];
+            if (cut) {
+                BitRows::set(stale, y);
+                change.changed = true;
+            }
+        }
+        if (change.changed)
+            commit(change);
+    }
+    return true;
+}
+
+template <typename Policy>
+std::uint64_t Engine<Policy>::count_looping_routes()
+{
+    // Per destination the next hops form a functional graph; walk each
+    // chain once, remembering for every router visited whether its chain
+    // ends in a loop.
+    const NodeId n = net_.node_count();
+    enum : std::uint8_t { unseen, on_walk, reaches, loops };
+    auto* state = scratch_.allocate_array<std::uint8_t>(n);
+    auto* walk = scratch_.allocate_array<NodeId>(n);
+    std::uint64_t looping = 0;
+    for (NodeId y = 0; y < n; ++y) {
+        std::fill_n(state, n, unseen);
+        state[y] = reaches;
+        for (NodeId x = 0; x < n; ++x) {
+            std::size_t length = 0;
+            NodeId u = x;
+            while (state[u] == unseen) {
+                state[u] = on_walk;
+                walk[length++] = u;
+                const NodeId next = next_hop(u, y);
+                if (next == kNoNode) {
+                    state[u] = reaches; // a dead end, not a loop
+                    --length;
+                    break;
+                }
+                u = next;
+            }
+            // Arriving back on this walk closes a loop.
+            const std::uint8_t end = state[u] == on_walk ? std::uint8_t{loops} : state[u];
+            for (std::size_t i = 0; i < length; ++i)
+                state[walk[i]] = end;
+            if (end == loops)
+                looping += length;
+        }
+    }
+    scratch_.reset();
+    return looping;
+}
+
+template <typename Policy>
+void Engine<Policy>::label_components()
+{
+    const NodeId n = net_.node_count();
+    const NodeId* targets = net_.targets();
+    component_.assign(n, kNoNode);
+    component_count_ = 0;
+    std::vector<NodeId> queue;
+    queue.reserve(n);
+    for (NodeId root = 0; root < n; ++root) {
+        if (component_[root] != kNoNode)
+            continue;
+        component_[root] = component_count_;
+        queue.assign(1, root);
+        for (std::size_t head = 0; head < queue.size(); ++head) {
+            const NodeId x = queue[head];
+            for (auto e = net_.offset(x), end = net_.offset(x + 1); e < end; ++e) {
+                if (component_[targets[e]] == kNoNode) {
+                    component_[targets[e]] = component_count_;
+                    queue.push_back(targets[e]);
+                }
+            }
+        }
+        ++component_count_;
+    }
+    // A zero-cost loop can hold a route to an unreachable destination at
+    // a finite cost forever, so cutting the count would change the result.
+    can_stop_counting_ = config_.stop_counting && !has_zero_cost_link();
+}
+
+template <typename Policy>
+bool Engine<Policy>::has_zero_cost_link() const
+{
+    const Cost* costs = net_.costs();
+    const auto links = net_.offset(net_.node_count());
+    return std::find(costs, costs + links, 0) != costs + links;
+}
+
+template <typename Policy>
+void Engine<Policy>::converge_async()
+{
+    DV_SCOPE("converge async");
+    // Zero-cost links can leave poisoned routes with more than one fixed
+    // point, so which one is reached would depend on the schedule.
+    if (pool_->size() > 1 && dirty_head_ < dirty_.size() && !has_zero_cost_link()) {
+        converge_sharded();
+        return;
+    }
+    while (dirty_head_ < dirty_.size()) {
+        const NodeId x = dirty_[dirty_head_++];
+        is_dirty_[x] = 0;
+        ++stats_.evaluations;
+        RowChange change = compact_ ? compute<CompactCost>(x) : compute<Cost>(x);
+        if (change.overflow) {
+            widen_tables();
+            stats_.widened = true;
+            full_[x] = 1;
+            change = compute<Cost>(x);
+        }
+        if (!change.changed)
+            continue;
+        commit(change);
+
+        // Compact the consumed prefix so the queue stays bounded by N.
+        if (dirty_head_ > net_.node_count() && dirty_head_ * 2 > dirty_.size()) {
+            dirty_.erase(dirty_.begin(), dirty_.begin() + dirty_head_);
+            dirty_head_ = 0;
+        }
+    }
+    dirty_.clear();
+    dirty_head_ = 0;
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::compute_round()
+{
+    // Tables in a file are swept in row order, so threads read it nearly
+    // sequentially and each tile can be fetched before it is reached.
+    if (table_file_)
+        std::sort(dirty_.begin(), dirty_.end());
+    const std::size_t count = dirty_.size();
+    round_arena_.reset();
+    changes_ = round_arena_.allocate_array<RowChange>(count);
+    auto* plans = round_arena_.allocate_array<SplitPlan>(count);
+    task_count_ = 0;
+    split_count_ = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        plans[i] = plan_split<Entry>(dirty_[i]);
+        task_count_ += plans[i].pieces;
+        split_count_ += plans[i].pieces > 1;
+    }
+    tasks_ = round_arena_.allocate_array<RoundTask>(task_count_);
+    splits_ = round_arena_.allocate_array<SplitRow>(split_count_);
+    std::size_t task = 0;
+    std::size_t split = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto slot = static_cast<std::uint32_t>(i);
+        const SplitPlan& plan = plans[i];
+        if (plan.pieces == 1) {
+            tasks_[task++] = {slot, kNoSplit, 0, 0, false};
+            continue;
+        }
+        const NodeId x = dirty_[i];
+        const std::size_t end = window_end<Entry>(x);
+        splits_[split] = {slot, plan.whole, static_cast<std::uint32_t>(task), plan.pieces};
+        for (std::size_t from = window_[x].begin; from < end; from += plan.piece)
+            tasks_[task++] = {slot, static_cast<std::uint32_t>(split), from, std::min(end, from + plan.piece), false};
+        ++split;
+    }
+
+    const std::size_t grain = std::max<std::size_t>(1, task_count_ / (std::size_t{pool_->size()} * 64));
+    pool_->run_stealing(task_count_, grain,
+        [this](std::size_t begin, std::size_t end, [[maybe_unused]] unsigned index) {
+            DV_SCOPE_ARG("round tasks", index);
+            NodeId tile = kNoNode;
+            for (std::size_t i = begin; i < end; ++i) {
+                if (table_file_ && dirty_[tasks_[i].slot] / tile_rows_ != tile) {
+                    tile = dirty_[tasks_[i].slot] / tile_rows_;
+                    prefetch_tile<Entry>(tile + 1);
+                }
+                run_task<Entry>(tasks_[i]);
+            }
+        });
+    if (split_count_ == 0)
+        return;
+    pool_->run(split_count_, [this](std::size_t begin, std::size_t end, unsigned) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const SplitRow& split = splits_[i];
+            const NodeId x = dirty_[split.slot];
+            bool saturated = false;
+            for (std::uint32_t k = 0; k < split.tasks; ++k)
+                saturated |= tasks_[split.first_task + k].saturated;
+            is_dirty_[x] = 0;
+            changes_[split.slot] = finish_row<Entry>(x, saturated);
+        }
+    });
+}
+
+template <typename Policy>
+template <typename Entry>
+typename Engine<Policy>::SplitPlan Engine<Policy>::plan_split(NodeId x) const
+{
+    const std::size_t begin = window_[x].begin;
+    const std::size_t end = window_end<Entry>(x);
+    const std::uint64_t degree = net_.degree(x);
+    // Only worth a look if the whole row could make two pieces, and only
+    // when other threads can take them.
+    if (pool_->size() == 1 || degree * (end - begin) < 2 * kSplitWork)
+        return {1, false, 0};
+    const bool whole = whole_row_pass(x);
+    const std::uint64_t work = degree * (whole ? end - begin : stale_.count(pending_.row(x)));
+    if (work < 2 * kSplitWork)
+        return {1, false, 0};
+    // Pieces are whole bitset words, so they write disjoint stale words.
+    const std::size_t words = (end - begin + BitRows::kWordBits - 1) / BitRows::kWordBits;
+    const std::size_t pieces = std::min<std::uint64_t>(work / kSplitWork, words);
+    const std::size_t piece = (words + pieces - 1) / pieces * BitRows::kWordBits;
+    return {static_cast<std::uint32_t>((end - begin + piece - 1) / piece), whole, piece};
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::prefetch_tile(NodeId tile) const
+{
+    const std::size_t first = std::size_t{tile} * tile_rows_;
+    if (first >= net_.node_count())
+        return;
+    const std::size_t rows = std::min<std::size_t>(tile_rows_, net_.node_count() - first);
+    const auto x = static_cast<NodeId>(first);
+    for (int i = 0; i < 2; ++i) {
+        const BasicRouteMatrix<Entry>& table = tables<Entry>()[i];
+        TableFile::prefetch(table.dist(x), rows * table.stride() * sizeof(Entry));
+        TableFile::prefetch(table.via(x), rows * table.stride() * sizeof(NodeId));
+    }
+    TableFile::prefetch(pending_.row(x), rows * pending_.words() * sizeof(BitRows::Word));
+    TableFile::prefetch(stale_.row(x), rows * stale_.words() * sizeof(BitRows::Word));
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::run_task(RoundTask& task)
+{
+    const NodeId x = dirty_[task.slot];
+    if (task.split == kNoSplit) {
+        is_dirty_[x] = 0;
+        changes_[task.slot] = compute<Entry>(x);
+    } else {
+        task.saturated = compute_range<Entry>(x, splits_[task.split].whole, task.begin, task.end);
+    }
+}
+
+template <typename Policy>
+void Engine<Policy>::converge_sharded()
+{
+    const auto shards = static_cast<std::uint32_t>(pool_->size());
+    shard_of_ = partition_routers(net_, shards, PartitionScheme::edge_cut);
+    async_shards_.resize(shards);
+    for (AsyncShard& shard : async_shards_) {
+        shard.queue.clear();
+        shard.head = 0;
+        shard.sends_to.assign(shards, 0);
+    }
+    mesh_ = std::make_unique<ShardMesh>(shards);
+    for (std::size_t i = dirty_head_; i < dirty_.size(); ++i)
+        async_shards_[shard_of_[dirty_[i]]].queue.push_back(dirty_[i]);
+    dirty_.clear();
+    dirty_head_ = 0;
+
+    sharded_ = true;
+    while (!(compact_ ? run_shards<CompactCost>() : run_shards<Cost>())) {
+        // A cost outgrew the compact tables. Deliver what was still on
+        // its way, then carry on in full width from copies of the widened
+        // rows.
+        mesh_->flush([this](std::uint32_t to, const Advertisement& ad) { receive<CompactCost>(to, ad); });
+        widen_tables();
+        stats_.widened = true;
+    }
+    sharded_ = false;
+
+    for (AsyncShard& shard : async_shards_) {
+        stats_.evaluations += shard.evaluations;
+        stats_.advertisements += shard.advertisements;
+        route_log_.insert(route_log_.end(), shard.route_log.begin(), shard.route_log.end());
+    }
+    async_shards_.clear();
+    mesh_.reset();
+}
+
+template <typename Policy>
+template <typename Entry>
+bool Engine<Policy>::run_shards()
+{
+    const auto shards = static_cast<std::uint32_t>(async_shards_.size());
+    // Ghost rows are copied before any shard starts writing its own.
+    pool_->run(shards, [this](std::size_t, std::size_t, unsigned index) { copy_ghost_rows<Entry>(index); });
+    mesh_->start();
+    pool_->run(shards, [this](std::size_t, std::size_t, unsigned index) { run_shard<Entry>(index); });
+    return !mesh_->stopped();
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::copy_ghost_rows(std::uint32_t s)
+{
+    const NodeId n = net_.node_count();
+    const NodeId* targets = net_.targets();
+    AsyncShard& shard = async_shards_[s];
+    shard.ghost_rows = RouteMatrix();
+    shard.compact_ghost_rows = CompactRouteMatrix();
+    BasicRouteMatrix<Entry>& ghosts = shard.template ghosts<Entry>();
+    ghosts = BasicRouteMatrix<Entry>::sparse(n, table_file_.get());
+    shard.is_ghost.assign(n, 0);
+    for (NodeId x = 0; x < n; ++x) {
+        if (shard_of_[x] != s)
+            continue;
+        for (auto e = net_.offset(x), end = net_.offset(x + 1); e < end; ++e) {
+            const NodeId v = targets[e];
+            if (shard_of_[v] == s || shard.is_ghost[v])
+                continue;
+            shard.is_ghost[v] = 1;
+            const std::size_t begin = window_[v].begin;
+            const std::size_t end_y = window_end<Entry>(v);
+            std::copy(current<Entry>(v).dist(v) + begin, current<Entry>(v).dist(v) + end_y, ghosts.dist(v) + begin);
+            std::copy(current<Entry>(v).via(v) + begin, current<Entry>(v).via(v) + end_y, ghosts.via(v) + begin);
+        }
+    }
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::run_shard(std::uint32_t s)
+{
+    DV_SCOPE_ARG("async shard", s);
+    AsyncShard& shard = async_shards_[s];
+    while (!mesh_->stopped()) {
+        receive_all<Entry>(s);
+        if (shard.head == shard.queue.size()) {
+            shard.queue.clear();
+            shard.head = 0;
+            // Idle until an advertisement arrives or every shard is idle
+            // with nothing in flight.
+            if (!mesh_->wait_for_work(s))
+                break;
+            continue;
+        }
+
+        const NodeId x = shard.queue[shard.head++];
+        is_dirty_[x] = 0;
+        ++shard.evaluations;
+        const RowChange change = compute<Entry>(x);
+        if (change.overflow) {
+            // Stop every shard; x is recomputed in full width.
+            full_[x] = 1;
+            queue_in_shard(s, x);
+            mesh_->stop();
+            break;
+        }
+        if (change.changed)
+            commit_sharded<Entry>(change, s);
+
+        if (shard.head > net_.node_count() && shard.head * 2 > shard.queue.size()) {
+            shard.queue.erase(shard.queue.begin(), shard.queue.begin() + shard.head);
+            shard.head = 0;
+        }
+    }
+}
+
+template <typename Policy>
+void Engine<Policy>::queue_in_shard(std::uint32_t s, NodeId x)
+{
+    if (!is_dirty_[x]) {
+        is_dirty_[x] = 1;
+        async_shards_[s].queue.push_back(x);
+    }
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::commit_sharded(const RowChange& change, std::uint32_t s)
+{
+    // No distance tables are printed, so only the route log observes it.
+    const NodeId x = change.router;
+    AsyncShard& shard = async_shards_[s];
+    if (recording_ && shown_[x])
+        log_route_changes<Entry>(x, shard.route_log);
+    current_[x] ^= 1;
+    shard.advertisements += net_.degree(x);
+    DV_COUNT(advertisements, net_.degree(x));
+
+    const BitRows::Word* changed = stale_.row(x);
+    const NodeId* targets = net_.targets();
+    bool remote = false;
+    for (auto e = net_.offset(x), end = net_.offset(x + 1); e < end; ++e) {
+        const NodeId v = targets[e];
+        if (shard_of_[v] != s) {
+            shard.sends_to[shard_of_[v]] = 1;
+            remote = true;
+            continue;
+        }
+        queue_in_shard(s, v);
+        BitRows::Word* pending = pending_.row(v);
+        for (std::size_t w = 0; w < stale_.words(); ++w)
+            pending[w] |= changed[w];
+    }
+    if (!remote)
+        return;
+
+    const Entry* dist = current<Entry>(x).dist(x);
+    const NodeId* via = current<Entry>(x).via(x);
+    shard.batch.clear();
+    stale_.for_each(changed, [&](std::size_t y) {
+        shard.batch.push_back({x, static_cast<NodeId>(y), widen(dist[y]), via[y]});
+    });
+    for (std::uint32_t to = 0; to < shard.sends_to.size(); ++to) {
+        if (shard.sends_to[to]) {
+            shard.sends_to[to] = 0;
+            mesh_->send(s, to, shard.batch.data(), shard.batch.size(),
+                        [this, s](const Advertisement& ad) { receive<Entry>(s, ad); });
+        }
+    }
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::receive_all(std::uint32_t s)
+{
+    mesh_->receive(s, [this, s](const Advertisement& ad) { receive<Entry>(s, ad); });
+}
+
+template <typename Policy>
+template <typename Entry>
+void Engine<Policy>::receive(std::uint32_t s, const Advertisement& ad)
+{
+    // The same bookkeeping commit() does for a neighbour in the shard.
+    BasicRouteMatrix<Entry>& ghosts = async_shards_[s].template ghosts<Entry>();
+    const NodeId v = ad.router;
+    const NodeId y = ad.dest;
+    Entry* dist = ghosts.dist(v);
+    NodeId* via = ghosts.via(v);
+    if (widen(dist[y]) == ad.dist && via[y] == ad.via)
+        return;
+    dist[y] = narrow<Entry>(ad.dist);
+    via[y] = ad.via;
+    const NodeId* targets = net_.targets();
+    for (auto e = net_.offset(v), end = net_.offset(v + 1); e < end; ++e) {
+        const NodeId w = targets[e];
+        if (shard_of_[w] == s) {
+            queue_in_shard(s, w);
+            BitRows::set(pending_.row(w), y);
+        }
+    }
+}
+
+template <typename Policy>
+bool Engine<Policy>::apply_updates(const std::vector<LinkLine>& updates)
+{
+    DV_SCOPE("update batch");
+    // Only links whose cost differs once the whole batch is applied make
+    // their endpoints dirty.
+    auto* before = scratch_.allocate_array<Cost>(updates.size());
+    for (std::size_t i = 0; i < updates.size(); ++i)
+        before[i] = net_.link_cost(updates[i].a, updates[i].b);
+    for (const auto& link : updates) {
+        if (link.cost == -1)
+            net_.remove_link(link.a, link.b);
+        else
+            net_.set_link(link.a, link.b, link.cost);
+    }
+    for (std::size_t i = 0; i < updates.size(); ++i) {
+        const LinkLine& link = updates[i];
+        if (net_.link_cost(link.a, link.b) != before[i]) {
+            if (owns(link.a))
+                touch(link.a);
+            if (owns(link.b))
+                touch(link.b);
+        }
+    }
+    net_.build(scratch_);
+    if (config_.cluster != nullptr) {
+        // A new link across the boundary needs each end's whole vector
+        // on the other side; every worker takes part in the exchange.
+        for (std::size_t i = 0; i < updates.size(); ++i) {
+            const LinkLine& link = updates[i];
+            if (before[i] < kInfinity || net_.link_cost(link.a, link.b) >= kInfinity
+                || part_[link.a] == part_[link.b])
+                continue;
+            for (const auto& [from, to] : {std::pair(link.a, link.b), std::pair(link.b, link.a)}) {
+                if (!owns(from))
+                    continue;
+                if (compact_)
+                    send_row<CompactCost>(from, part_[to]);
+                else
+                    send_row<Cost>(from, part_[to]);
+            }
+        }
+        exchange_ghost_rows();
+    }
+    scratch_.reset();
+    if (config_.stop_counting || windowed_)
+        label_components();
+    if (windowed_)
+        update_windows();
+    return !updates.empty();
+}
+
+template <typename Policy>
+ArenaStats Engine<Policy>::arena_stats() const
+{
+    ArenaStats stats;
+    stats.graph_peak = net_.storage().peak();
+    stats.scratch_peak = scratch_.peak();
+    stats.round_peak = round_arena_.peak();
+    return stats;
+}
+
+template <typename Policy>
+void Engine<Policy>::print_distance_tables(int t, OutputWriter& out) const
+{
+    DV_SCOPE_ARG("print distance tables", t);
+    const NodeId* targets = net_.targets();
+    const Cost* costs = net_.costs();
+    const bool only_changed = config_.tables == TableOutput::changed;
+    for (const NodeId x : order_) {
+        if ((only_changed && !table_changed_[x]) || !shows(x))
+            continue;
+        const auto first = net_.offset(x), last = net_.offset(x + 1);
+        out.write("Distance Table of router ");
+        out.write(names_.name(x));
+        out.write(" at t=");
+        out.write_int(t);
+        out.put(':');
+        out.end_line();
+
+        cell(out, "");
+        for (auto e = first; e < last; ++e)
+            cell(out, names_.name(targets[e]));
+        out.end_line();
+        for (const NodeId y : order_) {
+            if (y == x)
+                continue;
+            cell(out, names_.name(y));
+            for (auto e = first; e < last; ++e) {
+                const NodeId v = targets[e];
+                cost_cell(out, costs[e] + advertised<Policy>(route_cost(v, y), next_hop(v, y), x),
+                          config_.infinity);
+            }
+            out.end_line();
+        }
+        out.end_line();
+    }
+}
+
+template <typename Policy>
+void Engine<Policy>::print_routing_tables(OutputWriter& out) const
+{
+    if (config_.format != OutputFormat::text)
+        return;
+    DV_SCOPE("print routing tables");
+    for (const NodeId x : order_) {
+        if (!shows(x))
+            continue;
+        out.write("Routing Table of router ");
+        out.write(names_.name(x));
+        out.put(':');
+        out.end_line();
+        const NodeId* via = next_hops(x);
+        for (const NodeId y : order_) {
+            if (y == x)
+                continue;
+            out.write(names_.name(y));
+            const Cost dist = route_cost(x, y);
+            if (dist >= kInfinity) {
+                out.write(",INF,INF");
+            } else {
+                out.put(',');
+                out.write(names_.name(via[y]));
+                out.put(',');
+                out.write_uint(static_cast<std::uint32_t>(dist));
+            }
+            out.end_line();
+        }
+        out.end_line();
+    }
+}
+
+template <typename Policy>
+void Engine<Policy>::save_snapshot(const std::string& path, int round)
+{
+    // Snapshots hold dense Cost rows, like the tables they are mapped into.
+    widen_tables();
+    make_dense();
+    std::vector<RouteRow> rows(net_.node_count());
+    for (NodeId x = 0; x < rows.size(); ++x)
+        rows[x] = {route_costs(x), next_hops(x)};
+    write_snapshot(path, {Policy::kKind, config_.infinity, round}, names_, net_, rows);
+}
+
+template <typename Policy>
+void Engine<Policy>::record_route_changes()
+{
+    if (!recording_) {
+        logged_ = BitRows(net_.node_count(), net_.node_count(), table_file_.get());
+        recording_ = true;
+    }
+}
+
+template <typename Policy>
+std::size_t Engine<Policy>::print_route_changes(OutputWriter& out)
+{
+    DV_SCOPE("print route changes");
+    std::sort(route_log_.begin(), route_log_.end(), [&](const LoggedRoute& a, const LoggedRoute& b) {
+        return a.router != b.router ? rank_[a.router] < rank_[b.router] : rank_[a.dest] < rank_[b.dest];
+    });
+    std::size_t printed = 0;
+    for (const LoggedRoute& old : route_log_) {
+        // Every set bit is in the log, so whole words can be cleared.
+        logged_.row(old.router)[old.dest / BitRows::kWordBits] = 0;
+        const Cost dist = route_cost(old.router, old.dest);
+        const NodeId via = next_hop(old.router, old.dest);
+        if (dist == old.dist && via == old.via)
+            continue;
+        out.write(names_.name(old.router));
+        out.put(',');
+        out.write(names_.name(old.dest));
+        if (dist >= kInfinity) {
+            out.write(",INF,INF");
+        } else {
+            out.put(',');
+            out.write(names_.name(via));
+            out.put(',');
+            out.write_uint(static_cast<std::uint32_t>(dist));
+        }
+        out.end_line();
+        ++printed;
+    }
+    route_log_.clear();
+    return printed;
+}
+
+template class Engine<Plain>;
+template class Engine<SplitHorizon>;
+template class Engine<PoisonedReverse>;
+
+} // namespace dv
@@ -0,0 +1,594 @@
+#pragma once
+
+#include "arena.hpp"
+#include "bit_rows.hpp"
+#include "cost.hpp"
+#include "graph.hpp"
+#include "input.hpp"
+#include "minplus.hpp"
+#include "names.hpp"
+#include "output_writer.hpp"
+#include "policy.hpp"
+#include "route_matrix.hpp"
+#include "shard_mesh.hpp"
+#include "snapshot.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace dv {
+
+class WorkerLinks;
+
+// Peak bytes drawn from the engine's arenas over its lifetime.
+struct ArenaStats {
+    std::size_t graph_peak = 0;   // CSR adjacency
+    std::size_t round_peak = 0;   // per-round state
+    std::size_t scratch_peak = 0; // per-update graph rebuild temporaries
+};
+
+// Which distance tables converge() prints. Routing tables are always
+// printed in full.
+enum class TableOutput {
+    all,     // every router, every round
+    final,   // every router, converged round only
+    changed, // per round, only routers whose table changed since the last round
+    none,
+};
+
+// What converge() writes. The delta formats replace every table with one
+// record per route that changed in a round, and one marking each
+// convergence; see write_deltas().
+enum class OutputFormat {
+    text,   // distance and routing tables, as TableOutput configures
+    ndjson, // one JSON object per line, routers by name
+    binary, // fixed-size little-endian records, routers by position
+};
+
+// Work done since construction.
+struct EngineStats {
+    std::uint64_t rounds = 0;         // synchronous rounds computed
+    std::uint64_t evaluations = 0;    // router vector recomputations
+    std::uint64_t advertisements = 0; // changed vectors sent, per neighbour
+
+    // Count-to-infinity runs cut short by EngineConfig::stop_counting, an
+    // upper bound on the rounds they would still have taken, and the
+    // routes caught on next-hop loops when they were cut.
+    std::uint64_t counts_stopped = 0;
+    std::uint64_t rounds_skipped = 0;
+    std::uint64_t looping_routes = 0;
+
+    // Compact tables were switched to Cost entries after an overflow.
+    bool widened = false;
+};
+
+struct EngineConfig {
+    // Recompute only routers with a changed neighbour vector or incident
+    // link; false recomputes every router every round.
+    bool incremental = true;
+
+    // Worker threads for round execution; 0 uses every hardware thread.
+    unsigned threads = 1;
+
+    TableOutput tables = TableOutput::all;
+    // Anything but text prints no tables at all.
+    OutputFormat format = OutputFormat::text;
+
+    // Routers whose distance and routing tables are printed and whose
+    // route changes are logged; empty for every router.
+    std::vector<NodeId> query;
+
+    // Costs at or above this are unreachable, like RIP's 16; it bounds how
+    // far a router can count toward infinity.
+    Cost infinity = kInfinity;
+
+    // End a convergence early once a round's only changes are routers
+    // counting up toward destinations they can no longer reach; see
+    // converge(). Ignored while the graph has a zero-cost link.
+    bool stop_counting = false;
+
+    // Hold costs as CompactCost, halving the distance tables and doubling
+    // the entries per vector instruction. The first finite cost that does
+    // not fit switches them to Cost for the rest of the run, so the output
+    // is the same either way. Ignored on a warm start.
+    bool compact = false;
+
+    // Directory for a scratch file holding the distance tables and
+    // per-destination bitsets, so that they can outgrow memory; empty keeps
+    // them in memory. Rounds then recompute routers in ID order, one tile
+    // of rows at a time, reading the next tile ahead.
+    std::string table_dir;
+
+    // Run as one worker of a partitioned simulation (see cluster.hpp):
+    // only this worker's routers are computed and printed, and changes
+    // cross the partition boundary through these links.
+    WorkerLinks* cluster = nullptr;
+};
+
+// Synchronous distance-vector simulation. Every round each router rebuilds
+// its distance table from the vectors its neighbours held in the previous
+// round; routers, table rows and table columns all follow declaration
+// order, and ties go to the neighbour declared first.
+//
+// Only each router's best vector is stored; a distance table entry
+// D(x, y via v) is c(x, v) + D_v(y), so tables are rendered from the
+// neighbours' vectors when printed. A recomputation is a min-plus pass per
+// neighbour, over whole rows or only the pending destinations.
+//
+// Each router's vector is double-buffered: a round writes into the spare
+// buffer and only routers whose vector changed flip to it, so routers that
+// are not recomputed keep their previous vector without a copy. Within a
+// round the dirty routers are dealt out to a thread pool by work stealing,
+// a hub's row in several destination ranges; a task only writes its own
+// router's spare buffer and reads current ones, so the hot loop needs no
+// locks and the result does not depend on the thread count.
+//
+// Changes are also tracked per destination. When a router's vector
+// changes, the changed entries are added to each neighbour's pending set,
+// and a neighbour with only a few pending destinations recomputes just
+// those entries. Only link changes and busy rounds take the whole-row
+// path.
+//
+// A router's row is only stored over its window, the span of IDs in its
+// connected component, so partitioned networks take memory for their
+// reachable spans; see update_windows().
+//
+// Tables hold Cost entries, or optionally CompactCost ones until a cost
+// outgrows them (see EngineConfig::compact); the round that finds one is
+// recomputed in full width, so the results are the same.
+//
+// Policy (Plain, SplitHorizon or PoisonedReverse, see policy.hpp) decides
+// what each router advertises to each neighbour; the three variants are
+// instantiated in engine.cpp.
+template <typename Policy>
+class Engine {
+public:
+    // Given a snapshot, which must be the one topo was read from, starts
+    // from its converged vectors, adopted in place, with nothing dirty
+    // until apply_updates().
+    Engine(const Topology& topo, const EngineConfig& config = {}, Snapshot snapshot = {});
+
+    // Runs rounds from t until no router's vector changes, printing each
+    // round's distance tables. Returns the last round printed.
+    //
+    // With stop_counting, a round whose changes are all to destinations in
+    // another connected component ends the count: those routes can only
+    // count up, the component's cheapest finite one rising every round,
+    // until they reach infinity, so they are set to infinity at once and
+    // the next round, which then changes nothing, is printed as the last.
+    // Everything else is already final, as each destination's column
+    // evolves independently within each component.
+    int converge(int t, OutputWriter& out);
+
+    // Converges without rounds: a FIFO worklist re-evaluates a router
+    // against its neighbours' latest vectors, and a router that changes
+    // queues its neighbours. No distance tables are printed.
+    //
+    // With more than one thread, the routers are split into that many
+    // edge-cut shards and each thread runs its own worklist with no
+    // barrier between them: a shard reads other shards' vectors from its
+    // own copies, which their changes reach as advertisements through a
+    // ring per ordered pair of shards. With positive link costs every
+    // schedule ends at the same vectors, so the routing tables match the
+    // single-threaded run's; a graph with a zero-cost link runs on one.
+    void converge_async();
+
+    // Applies the UPDATE section and marks the endpoints of links whose
+    // cost changed dirty; returns false if it was empty.
+    bool apply_updates(const std::vector<LinkLine>& updates);
+
+    void print_routing_tables(OutputWriter& out) const;
+
+    // Starts logging route changes for print_route_changes(). Off by
+    // default, so a one-shot run keeps no log.
+    void record_route_changes();
+    // Prints every route whose cost or next hop differs from when it was
+    // last printed, or from when recording started, as
+    // router,destination,next hop,cost in declaration order. Routes that
+    // changed and changed back are left out. Returns the number printed.
+    std::size_t print_route_changes(OutputWriter& out);
+
+    // Router x's current vector: its cost and next hop to every router.
+    // The whole rows need dense Cost tables; see widen_tables() and
+    // make_dense().
+    const Cost* route_costs(NodeId x) const { return current<Cost>(x).dist(x); }
+    const NodeId* next_hops(NodeId x) const
+    {
+        return compact_ ? current<CompactCost>(x).via(x) : current<Cost>(x).via(x);
+    }
+    Cost route_cost(NodeId x, NodeId y) const
+    {
+        if (!in_window(x, y))
+            return kInfinity;
+        return compact_ ? widen(current<CompactCost>(x).dist(x)[y]) : current<Cost>(x).dist(x)[y];
+    }
+    NodeId next_hop(NodeId x, NodeId y) const { return in_window(x, y) ? next_hops(x)[y] : kNoNode; }
+
+    // Whether the tables hold CompactCost entries; see EngineConfig.
+    bool compact() const { return compact_; }
+    // Switches compact tables to Cost entries for good, as an overflow
+    // does.
+    void widen_tables();
+    // Stores every row in full from now on, with the entries outside
+    // each router's window set unreachable.
+    void make_dense();
+    // Row entries stored per table buffer, below rows times stride while
+    // some windows are narrower than the rows.
+    std::uint64_t stored_entries() const;
+
+    // Writes the graph and every router's vector, widening compact tables
+    // first; see write_snapshot().
+    void save_snapshot(const std::string& path, int round);
+
+    const EngineStats& stats() const { return stats_; }
+    ArenaStats arena_stats() const;
+
+private:
+    // Both buffers of tables_ or compact_tables_, whichever Entry names.
+    template <typename Entry>
+    BasicRouteMatrix<Entry>* tables()
+    {
+        if constexpr (std::is_same_v<Entry, CompactCost>)
+            return compact_tables_;
+        else
+            return tables_;
+    }
+    template <typename Entry>
+    const BasicRouteMatrix<Entry>* tables() const
+    {
+        return const_cast<Engine*>(this)->tables<Entry>();
+    }
+    template <typename Entry>
+    const BasicRouteMatrix<Entry>& current(NodeId x) const
+    {
+        return tables<Entry>()[current_[x]];
+    }
+    template <typename Entry>
+    BasicRouteMatrix<Entry>& spare(NodeId x)
+    {
+        return tables<Entry>()[current_[x] ^ 1];
+    }
+    // v's vector as its neighbour x reads it: v's current row, or during a
+    // sharded converge_async() the copy in x's shard when v is elsewhere.
+    template <typename Entry>
+    const BasicRouteMatrix<Entry>& neighbour_row(NodeId x, NodeId v) const
+    {
+        if (!sharded_ || shard_of_[v] == shard_of_[x])
+            return current<Entry>(v);
+        return async_shards_[shard_of_[x]].template ghosts<Entry>();
+    }
+    // Fresh tables: every router's vector holds only its own entry.
+    template <typename Entry>
+    void init_tables();
+
+    // Row x holds destinations [begin, end) of its window, end clamped to
+    // the stride; everything outside is unreachable and never read. Both
+    // ends are multiples of kWindowAlign, so kernels and bitset words line
+    // up, and linked routers share a window, so a relaxation reads the
+    // same span it writes.
+    struct Window {
+        std::size_t begin;
+        std::size_t end;
+    };
+    static constexpr std::size_t kWindowAlign = 64;
+    bool in_window(NodeId x, NodeId y) const { return y >= window_[x].begin && y < window_[x].end; }
+    template <typename Entry>
+    std::size_t window_end(NodeId x) const
+    {
+        return std::min(window_[x].end, tables<Entry>()[0].stride());
+    }
+    // Sets each component's window to the span of its routers' IDs and
+    // old windows, clearing the entries it gains; a window over most of
+    // the row takes all of it.
+    void update_windows();
+    template <typename Entry>
+    void grow_window(NodeId x, const Window& to);
+    template <typename Entry>
+    void grow_windows();
+    Window whole_row() const
+    {
+        return {0, (std::size_t{net_.node_count()} + kWindowAlign - 1) / kWindowAlign * kWindowAlign};
+    }
+
+    // Whether x is computed here rather than in another partition.
+    bool owns(NodeId x) const { return part_ == nullptr || part_[x] == self_; }
+    // Whether x's tables are printed here.
+    bool shows(NodeId x) const { return shown_[x] && owns(x); }
+
+    void mark_dirty(NodeId x);
+    // Marks x dirty and its distance table as changed for the next round.
+    void touch(NodeId x);
+    void mark_all_dirty();
+    // What a recomputation did to a router's vector.
+    struct RowChange {
+        NodeId router;
+        bool changed = false; // costs or next hops differ
+        bool cut_off_only = true; // every change is to a destination in another component
+        bool overflow = false; // a cost did not fit compact tables; the row is void
+    };
+
+    // Below one pending destination in this many, a router recomputes
+    // just those entries instead of running whole-row kernels.
+    static constexpr std::size_t kSparseRatio = 16;
+
+    // Relaxations above which a round splits one router's recomputation
+    // over destination ranges, so a hub does not hold up the round.
+    static constexpr std::uint64_t kSplitWork = std::uint64_t{1} << 18;
+
+    // The members templated on Entry read and write table entries; the
+    // engine calls them with CompactCost while compact_ and Cost after.
+    template <typename Entry>
+    RowChange compute(NodeId x);
+    // compute() in two steps: recomputes destinations [begin, end) of x's
+    // spare row, whole-row style or only the pending ones, and returns
+    // whether a cost saturated compact tables; a row's ranges can run in
+    // parallel if they split it on word boundaries. finish_row() then
+    // sums up the whole row.
+    bool whole_row_pass(NodeId x) const;
+    template <typename Entry>
+    bool compute_range(NodeId x, bool whole, std::size_t begin, std::size_t end);
+    template <typename Entry>
+    RowChange finish_row(NodeId x, bool saturated);
+    // Flips x to its spare row and queues its neighbours.
+    void commit(const RowChange& change);
+    // What must see x's spare row before it replaces the current one.
+    template <typename Entry>
+    void observe_commit(NodeId x);
+    // Logs the first change since the last report of each of x's stale
+    // entries, with the route it replaces, to log.
+    struct LoggedRoute {
+        NodeId router;
+        NodeId dest;
+        Cost dist;
+        NodeId via;
+    };
+    template <typename Entry>
+    void log_route_changes(NodeId x, std::vector<LoggedRoute>& log);
+    // Marks the neighbours of x whose distance table changes when x's
+    // spare row is committed; only --tables changed needs this.
+    template <typename Entry>
+    void mark_changed_views(NodeId x);
+    void print_distance_tables(int t, OutputWriter& out) const;
+
+    // Delta output. Every committed change to a shown router's vector is
+    // logged, and each round writes its log in declaration order, a route
+    // changed twice since the last write as one record.
+    //
+    //   ndjson: {"round":3,"router":"A","dest":"B","old":5,"new":null,"via":null}
+    //           {"round":4,"converged":true}
+    //   binary: six 32-bit little-endian fields per record: round, router,
+    //           destination, old cost, new cost, next hop. Routers are
+    //           positions in declaration order; unreachable costs and
+    //           missing hops are all ones, and a convergence record has
+    //           them as router and destination.
+    struct RouteDelta {
+        NodeId router;
+        NodeId dest;
+        Cost old_dist;
+        NodeId old_via;
+        Cost dist;
+        NodeId via;
+    };
+    template <typename Entry>
+    void log_deltas(NodeId x);
+    void write_deltas(int t, OutputWriter& out);
+    void write_converged(int t, OutputWriter& out) const;
+
+    // A round's work: one task per dirty router, or one per destination
+    // range for a split one, run by the pool's work-stealing scheduler.
+    // Each router's RowChange lands at its index in dirty_.
+    struct RoundTask {
+        std::uint32_t slot;  // index in dirty_
+        std::uint32_t split; // index in splits_, or kNoSplit
+        std::size_t begin;   // destination range, for a split router
+        std::size_t end;
+        bool saturated;
+    };
+    struct SplitRow {
+        std::uint32_t slot;
+        bool whole; // whole_row_pass() as planned
+        std::uint32_t first_task;
+        std::uint32_t tasks;
+    };
+    static constexpr std::uint32_t kNoSplit = ~std::uint32_t{0};
+    // How a router's recomputation is cut: into pieces of piece
+    // destinations if it is above kSplitWork relaxations twice over.
+    struct SplitPlan {
+        std::uint32_t pieces;
+        bool whole;
+        std::size_t piece;
+    };
+    template <typename Entry>
+    void compute_round();
+    template <typename Entry>
+    SplitPlan plan_split(NodeId x) const;
+    template <typename Entry>
+    void run_task(RoundTask& task);
+    // Rows per tile of a table file: kTileBytes of each buffer's costs.
+    static constexpr std::size_t kTileBytes = std::size_t{1} << 22;
+    template <typename Entry>
+    void prefetch_tile(NodeId tile) const;
+
+    // Sharded converge_async(). A changed entry of a router's vector is
+    // advertised once to each other shard holding one of its neighbours;
+    // a commit's entries go as one batch.
+    struct AsyncShard {
+        // The shard's worklist, read from head.
+        std::vector<NodeId> queue;
+        std::size_t head = 0;
+        // Copies of the vectors of other shards' routers linked to this
+        // shard's, current in whichever matrix the tables' Entry names.
+        RouteMatrix ghost_rows;
+        CompactRouteMatrix compact_ghost_rows;
+        std::vector<std::uint8_t> is_ghost;
+        std::vector<Advertisement> batch;
+        std::vector<std::uint8_t> sends_to;
+        std::vector<LoggedRoute> route_log;
+        std::uint64_t evaluations = 0;
+        std::uint64_t advertisements = 0;
+
+        template <typename Entry>
+        BasicRouteMatrix<Entry>& ghosts()
+        {
+            if constexpr (std::is_same_v<Entry, CompactCost>)
+                return compact_ghost_rows;
+            else
+                return ghost_rows;
+        }
+        template <typename Entry>
+        const BasicRouteMatrix<Entry>& ghosts() const
+        {
+            return const_cast<AsyncShard*>(this)->ghosts<Entry>();
+        }
+    };
+    void converge_sharded();
+    // Runs every shard to quiescence; false if one stopped them all on a
+    // cost that does not fit compact tables.
+    template <typename Entry>
+    bool run_shards();
+    template <typename Entry>
+    void copy_ghost_rows(std::uint32_t s);
+    template <typename Entry>
+    void run_shard(std::uint32_t s);
+    // Like commit(), with neighbours in other shards sent the changes.
+    template <typename Entry>
+    void commit_sharded(const RowChange& change, std::uint32_t s);
+    // Applies every advertisement waiting for shard s.
+    template <typename Entry>
+    void receive_all(std::uint32_t s);
+    template <typename Entry>
+    void receive(std::uint32_t s, const Advertisement& ad);
+    void queue_in_shard(std::uint32_t s, NodeId x);
+
+    // Partitioned runs. A change to an owned router's vector is queued
+    // once for each other partition holding its neighbours, as the
+    // router, an entry count and that many (destination, cost, next hop)
+    // entries; the same record with every entry sends a whole vector.
+    struct GhostEntry {
+        NodeId dest;
+        Cost dist;
+        NodeId via;
+    };
+    template <typename Entry>
+    void send_row_changes(NodeId x);
+    template <typename Entry>
+    void send_row(NodeId x, std::uint32_t to);
+    // Swaps the queued records with the other workers and applies the
+    // ones received to the ghost rows, queueing their owned neighbours.
+    void exchange_ghost_rows();
+    static bool fits_compact(const std::vector<char>& records);
+    template <typename Entry>
+    void apply_ghost_rows(const std::vector<char>& records);
+    template <typename Entry>
+    void init_ghost_row(NodeId v);
+
+    // Labels connected components for stop_counting and the windows.
+    void label_components();
+    bool has_zero_cost_link() const;
+    // Sets every route to a destination outside the router's component
+    // unreachable; returns false if there was none.
+    template <typename Entry>
+    bool cut_count_to_infinity();
+    // Routes whose next-hop chain runs into a loop instead of reaching
+    // the destination.
+    std::uint64_t count_looping_routes();
+
+    const NameTable& names_;
+    // Topology::rank of every router, and the routers in declaration
+    // order, which is the order they and their destinations are printed in.
+    std::vector<NodeId> rank_;
+    std::vector<NodeId> order_;
+    EngineConfig config_;
+    EngineStats stats_;
+    Graph net_;
+    RelaxKernels kernels_;
+
+    // A warm start's snapshot, mapped for as long as tables_[0] borrows
+    // its vectors.
+    Snapshot snapshot_;
+    // Backs the tables and bitsets under EngineConfig::table_dir.
+    std::unique_ptr<TableFile> table_file_;
+    NodeId tile_rows_ = 0;
+    RouteMatrix tables_[2];
+    CompactRouteMatrix compact_tables_[2]; // in use instead while compact_
+    bool compact_ = false;
+    std::vector<std::uint8_t> current_;
+
+    // Per router, over destinations: pending_ marks entries some
+    // neighbour's vector changed since the router was last computed, and
+    // stale_ those where its spare row differs from its current one.
+    // full_ routers recompute every destination, as after a link change.
+    BitRows pending_;
+    BitRows stale_;
+    std::vector<std::uint8_t> full_;
+
+    // Routes changed since the last print_route_changes(): a bit per
+    // route, set on its first change, and the route as it was then.
+    bool recording_ = false;
+    BitRows logged_;
+    std::vector<LoggedRoute> route_log_;
+    // Delta records since the last round written.
+    std::vector<RouteDelta> deltas_;
+
+    // Routers awaiting recomputation; the FIFO of converge_async() reads
+    // it from dirty_head_.
+    std::vector<NodeId> dirty_;
+    std::size_t dirty_head_ = 0;
+    std::vector<std::uint8_t> is_dirty_;
+    std::vector<std::uint8_t> table_changed_;
+    // EngineConfig::query as a flag per router. Distance tables are only
+    // ever rendered, from the neighbours' vectors, for these.
+    std::vector<std::uint8_t> shown_;
+
+    // Connected component of each router, kept only for stop_counting,
+    // and whether that is currently possible.
+    std::vector<NodeId> component_;
+    NodeId component_count_ = 0;
+    bool can_stop_counting_ = false;
+
+    // Per-round state lives in round_arena_ and is reset at the start of
+    // the next round.
+    std::unique_ptr<ThreadPool> pool_;
+    Arena round_arena_;
+    RowChange* changes_ = nullptr;
+    RoundTask* tasks_ = nullptr;
+    std::size_t task_count_ = 0;
+    SplitRow* splits_ = nullptr;
+    std::size_t split_count_ = 0;
+
+    // Graph rebuild temporaries, reset after each UPDATE batch.
+    Arena scratch_;
+
+    // The partition of every router and this worker's, for cluster runs.
+    // Every ghost row, a copy of a router's vector from another
+    // partition, is current in tables_[0].
+    const std::uint32_t* part_ = nullptr;
+    std::uint32_t self_ = 0;
+    std::vector<std::uint8_t> is_ghost_;
+    std::vector<std::vector<char>> outbox_;
+    std::vector<std::vector<char>> inbox_;
+    std::vector<std::uint8_t> queued_for_;
+    std::vector<NodeId> printed_;
+
+    // Windowed tables: rows are lazily committed storage with only the
+    // windows written, so memory follows the reachable spans instead of
+    // rows times rows. Off for partitioned runs and warm starts, and once
+    // every window is the whole row.
+    std::vector<Window> window_;
+    bool windowed_ = false;
+
+    // Sharded asynchronous runs: each router's shard, and the shards'
+    // rings and termination counter.
+    bool sharded_ = false;
+    std::vector<std::uint32_t> shard_of_;
+    std::vector<AsyncShard> async_shards_;
+    std::unique_ptr<ShardMesh> mesh_;
+};
+
+} // namespace dv
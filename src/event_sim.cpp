@@ -0,0 +1,275 @@
+#include "event_sim.hpp"
+
+#include "arena.hpp"
+#include "instrument.hpp"
+#include "policy.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace dv {
+
+template <typename Policy>
+EventSim<Policy>::EventSim(const Topology& topo, const SimConfig& config)
+    : names_(topo.names)
+    , config_(config)
+    , n_(topo.names.size())
+    , net_(n_)
+{
+    // Every link the run will have, whether up now or only after UPDATE.
+    for (const auto& l : topo.links)
+        net_.set_link(l.a, l.b, l.cost);
+    for (const auto& l : topo.updates) {
+        if (l.cost >= 0)
+            net_.set_link(l.a, l.b, l.cost);
+    }
+    Arena scratch;
+    net_.build(scratch);
+
+    const std::uint32_t links = net_.offset(n_);
+    const NodeId* targets = net_.targets();
+    reverse_.resize(links);
+    for (NodeId x = 0; x < n_; ++x) {
+        for (auto e = net_.offset(x), end = net_.offset(x + 1); e < end; ++e)
+            reverse_[e] = link(targets[e], x);
+    }
+    cost_.assign(links, 0);
+    delay_.assign(links, kDefaultDelay);
+    up_.assign(links, 0);
+    for (const auto& l : topo.links) {
+        if (l.a == l.b)
+            continue;
+        const std::uint32_t e = link(l.a, l.b);
+        cost_[e] = cost_[reverse_[e]] = l.cost;
+        up_[e] = up_[reverse_[e]] = 1;
+        if (l.delay != kNoDelay)
+            delay_[e] = delay_[reverse_[e]] = l.delay;
+    }
+
+    // Buckets as wide as the shortest delay the run can see, over the
+    // longest, unless that would take more than the queue's cap.
+    Delay shortest = kMaxDelay;
+    Delay longest = 1;
+    auto cover = [&](Delay d) {
+        shortest = std::min(shortest, d);
+        longest = std::max(longest, d);
+    };
+    for (const Delay d : delay_)
+        cover(d);
+    for (const auto& l : topo.updates) {
+        if (l.delay != kNoDelay)
+            cover(l.delay);
+    }
+    events_ = CalendarQueue<Event, Later>(shortest, longest);
+
+    heard_.assign(std::size_t{links} * n_, kInfinity);
+    routes_ = RouteMatrix(n_);
+    for (NodeId x = 0; x < n_; ++x) {
+        routes_.dist(x)[x] = 0;
+        routes_.via(x)[x] = x;
+    }
+    is_touched_.assign(n_, 0);
+    shown_.assign(n_, config_.query.empty());
+    for (const NodeId x : config_.query)
+        shown_[x] = 1;
+}
+
+template <typename Policy>
+std::uint32_t EventSim<Policy>::link(NodeId u, NodeId v) const
+{
+    const NodeId* first = net_.targets() + net_.offset(u);
+    const NodeId* last = net_.targets() + net_.offset(u + 1);
+    return static_cast<std::uint32_t>(std::lower_bound(first, last, v) - net_.targets());
+}
+
+template <typename Policy>
+SimReport EventSim<Policy>::converge()
+{
+    DV_SCOPE("simulate");
+    if (!started_) {
+        started_ = true;
+        for (NodeId x = 0; x < n_; ++x) {
+            for (auto e = net_.offset(x), end = net_.offset(x + 1); e < end; ++e) {
+                if (up_[e])
+                    send(x, x, e, now_);
+            }
+        }
+    }
+
+    while (!events_.empty()) {
+        report_.peak_in_flight = std::max(report_.peak_in_flight, events_.size());
+        now_ = events_.top().time;
+        const NodeId x = events_.top().to;
+        // Everything arriving at x now, then its one recomputation. Events
+        // at one time share a bucket, so the next is looked for there.
+        const Event* next;
+        do {
+            const Event& event = events_.top();
+            heard(event.link)[event.dest] = event.cost;
+            if (!is_touched_[event.dest]) {
+                is_touched_[event.dest] = 1;
+                touched_.push_back(event.dest);
+            }
+            ++report_.advertisements;
+            events_.pop();
+            next = events_.next_in_bucket();
+        } while (next && next->time == now_ && next->to == x);
+        for (const NodeId y : touched_) {
+            is_touched_[y] = 0;
+            recompute(x, y, now_);
+        }
+        touched_.clear();
+    }
+    DV_COUNT(advertisements, report_.advertisements);
+    DV_COUNT(relaxations, report_.relaxations);
+    DV_COUNT(entries_changed, report_.route_changes);
+    return std::exchange(report_, SimReport{now_, now_});
+}
+
+template <typename Policy>
+void EventSim<Policy>::recompute(NodeId x, NodeId y, std::uint64_t now)
+{
+    if (y == x)
+        return;
+    const NodeId* targets = net_.targets();
+    Cost best = kInfinity;
+    NodeId via = kNoNode;
+    for (auto e = net_.offset(x), end = net_.offset(x + 1); e < end; ++e) {
+        if (!up_[e])
+            continue;
+        const Cost d = cost_[e] + heard(e)[y];
+        if (d < best) {
+            best = d;
+            via = targets[e];
+        }
+    }
+    report_.relaxations += net_.degree(x);
+    if (best >= config_.infinity) {
+        best = kInfinity;
+        via = kNoNode;
+    }
+    Cost& dist = routes_.dist(x)[y];
+    NodeId& hop = routes_.via(x)[y];
+    if (best == dist && via == hop)
+        return;
+    dist = best;
+    hop = via;
+    ++report_.route_changes;
+    report_.end = now;
+    for (auto e = net_.offset(x), end = net_.offset(x + 1); e < end; ++e) {
+        if (up_[e])
+            send(x, y, e, now);
+    }
+}
+
+template <typename Policy>
+void EventSim<Policy>::send(NodeId x, NodeId y, std::uint32_t e, std::uint64_t now)
+{
+    const NodeId w = net_.targets()[e];
+    const Cost cost = advertised<Policy>(routes_.dist(x)[y], routes_.via(x)[y], w);
+    events_.push({now + delay_[e], w, reverse_[e], y, cost});
+}
+
+template <typename Policy>
+bool EventSim<Policy>::apply_updates(const std::vector<LinkLine>& updates)
+{
+    if (updates.empty())
+        return false;
+    auto touch = [this](NodeId x) {
+        if (!is_touched_[x]) {
+            is_touched_[x] = 1;
+            touched_.push_back(x);
+        }
+    };
+    std::vector<std::uint32_t> opened;
+    for (const auto& l : updates) {
+        if (l.a == l.b || (l.cost < 0 && net_.link_cost(l.a, l.b) >= kInfinity))
+            continue;
+        const std::uint32_t e = link(l.a, l.b);
+        const std::uint32_t r = reverse_[e];
+        if (l.delay != kNoDelay)
+            delay_[e] = delay_[r] = l.delay;
+        if (l.cost < 0) {
+            if (up_[e]) {
+                up_[e] = up_[r] = 0;
+                std::fill_n(heard(e), n_, kInfinity);
+                std::fill_n(heard(r), n_, kInfinity);
+                touch(l.a);
+                touch(l.b);
+            }
+            continue;
+        }
+        if (!up_[e]) {
+            up_[e] = up_[r] = 1;
+            opened.push_back(e);
+            opened.push_back(r);
+        }
+        if (cost_[e] != l.cost) {
+            cost_[e] = cost_[r] = l.cost;
+            touch(l.a);
+            touch(l.b);
+        }
+    }
+
+    // Nothing is in flight, so the changes all land at the present instant.
+    for (const NodeId x : touched_) {
+        is_touched_[x] = 0;
+        for (NodeId y = 0; y < n_; ++y)
+            recompute(x, y, now_);
+    }
+    touched_.clear();
+    const NodeId* targets = net_.targets();
+    for (const std::uint32_t e : opened) {
+        const NodeId x = targets[reverse_[e]];
+        for (NodeId y = 0; y < n_; ++y) {
+            if (routes_.dist(x)[y] < kInfinity)
+                send(x, y, e, now_);
+        }
+    }
+    return true;
+}
+
+template <typename Policy>
+void EventSim<Policy>::print_routing_tables(OutputWriter& out) const
+{
+    for (NodeId x = 0; x < n_; ++x) {
+        if (!shown_[x])
+            continue;
+        out.write("Routing Table of router ");
+        out.write(names_.name(x));
+        out.put(':');
+        out.end_line();
+        const Cost* dist = routes_.dist(x);
+        const NodeId* via = routes_.via(x);
+        for (NodeId y = 0; y < n_; ++y) {
+            if (y == x)
+                continue;
+            out.write(names_.name(y));
+            if (dist[y] >= kInfinity) {
+                out.write(",INF,INF");
+            } else {
+                out.put(',');
+                out.write(names_.name(via[y]));
+                out.put(',');
+                out.write_uint(static_cast<std::uint32_t>(dist[y]));
+            }
+            out.end_line();
+        }
+        out.end_line();
+    }
+}
+
+template <typename Policy>
+std::vector<RouteRow> EventSim<Policy>::rows() const
+{
+    std::vector<RouteRow> rows(n_);
+    for (NodeId x = 0; x < n_; ++x)
+        rows[x] = {routes_.dist(x), routes_.via(x)};
+    return rows;
+}
+
+template class EventSim<Plain>;
+template class EventSim<SplitHorizon>;
+template class EventSim<PoisonedReverse>;
+
+} // namespace dv
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "calendar_queue.hpp"
+#include "cost.hpp"
+#include "graph.hpp"
+#include "input.hpp"
+#include "names.hpp"
+#include "output_writer.hpp"
+#include "route_matrix.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dv {
+
+struct SimConfig {
+    Cost infinity = kInfinity; // as EngineConfig::infinity
+    // Routers whose routing tables are printed; empty for every router.
+    std::vector<NodeId> query;
+};
+
+// One convergence: from its first event to the last one that changed
+// anything, in microseconds of simulated time, and the work it took.
+struct SimReport {
+    std::uint64_t start = 0;
+    std::uint64_t end = 0;
+    std::uint64_t advertisements = 0;  // entries delivered
+    std::uint64_t relaxations = 0;     // neighbour entries compared
+    std::uint64_t route_changes = 0;
+    std::size_t peak_in_flight = 0;
+};
+
+// Discrete-event distance vector, for --simulate. Instead of lockstep
+// rounds, each changed entry of a router's vector is sent to every
+// neighbour as an event that arrives the link's delay later, and a router
+// acts only when something arrives. Everything arriving at one router at
+// one instant is applied together before it recomputes, so the run is
+// deterministic, and a link delivers in order by construction: its delay
+// only changes while nothing is in flight.
+//
+// Each router keeps the last vector heard over each of its links, which
+// is what a real router holds; the tables a router ends up with are the
+// engine's, since both settle on the first neighbour in declaration order
+// on a shortest path. The set of links is fixed when the simulation is
+// built, with links first declared in the UPDATE section starting out
+// down, so the per-link vectors never move.
+template <typename Policy>
+class EventSim {
+public:
+    EventSim(const Topology& topo, const SimConfig& config);
+
+    // Runs until nothing is in flight and reports on the run since the
+    // last call. The first call starts every router off advertising itself
+    // at time zero.
+    SimReport converge();
+
+    // Applies link changes at the present instant, once converge() has
+    // returned; returns false if there were none. A link that comes up is
+    // sent both endpoints' whole vectors.
+    bool apply_updates(const std::vector<LinkLine>& updates);
+
+    void print_routing_tables(OutputWriter& out) const;
+    // Every router's vector, for LinkState::verify().
+    std::vector<RouteRow> rows() const;
+
+    // The event queue's bucket width in microseconds and ring length.
+    std::uint64_t bucket_width() const { return events_.width(); }
+    std::size_t bucket_count() const { return events_.bucket_count(); }
+
+private:
+    struct Event {
+        std::uint64_t time;
+        NodeId to;
+        std::uint32_t link; // the receiver's link it arrives on
+        NodeId dest;
+        Cost cost;
+    };
+    // Orders events by time, then receiver, so one router's arrivals at
+    // one instant come out together.
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const
+        {
+            return a.time != b.time ? a.time > b.time : a.to > b.to;
+        }
+    };
+
+    // Link index of u's link to v in the CSR rows.
+    std::uint32_t link(NodeId u, NodeId v) const;
+    Cost* heard(std::uint32_t e) { return heard_.data() + std::size_t{e} * n_; }
+    // Recomputes x's route to y from what it has heard and sends it to
+    // every neighbour if it changed.
+    void recompute(NodeId x, NodeId y, std::uint64_t now);
+    void send(NodeId x, NodeId y, std::uint32_t e, std::uint64_t now);
+
+    const NameTable& names_;
+    SimConfig config_;
+    NodeId n_;
+    Graph net_;
+    std::vector<std::uint32_t> reverse_; // the same link seen from its other end
+    std::vector<Cost> cost_;
+    std::vector<Delay> delay_;
+    std::vector<std::uint8_t> up_;
+    std::vector<Cost> heard_; // per link, the vector last heard over it
+    RouteMatrix routes_;
+    CalendarQueue<Event, Later> events_;
+    std::uint64_t now_ = 0;
+    bool started_ = false;
+    // The convergence under way, including the recomputation of the
+    // updates that started it.
+    SimReport report_;
+    // Routers and destinations to recompute, and their flags.
+    std::vector<NodeId> touched_;
+    std::vector<std::uint8_t> is_touched_;
+    std::vector<std::uint8_t> shown_;
+};
+
+} // namespace dv
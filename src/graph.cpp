@@ -0,0 +1,129 @@
+#include "graph.hpp"
+
+#include "instrument.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace dv {
+
+namespace {
+
+struct Neighbour {
+    NodeId rank;
+    NodeId target;
+    Cost cost;
+
+    bool operator<(const Neighbour& o) const { return rank < o.rank; }
+};
+
+} // namespace
+
+Graph::Graph(NodeId node_count)
+    : node_count_(node_count)
+    , storage_(std::size_t(1) << 20)
+{
+}
+
+std::uint64_t Graph::key(NodeId u, NodeId v)
+{
+    if (u > v)
+        std::swap(u, v);
+    return (static_cast<std::uint64_t>(u) << 32) | v;
+}
+
+void Graph::set_link(NodeId u, NodeId v, Cost cost)
+{
+    if (u == v)
+        return;
+    auto [it, inserted] = links_.try_emplace(key(u, v), cost);
+    if (inserted) {
+        dirty_ = true;
+        return;
+    }
+    it->second = cost;
+    if (!dirty_) {
+        patch_cost(u, v, cost);
+        patch_cost(v, u, cost);
+    }
+}
+
+void Graph::remove_link(NodeId u, NodeId v)
+{
+    if (links_.erase(key(u, v)) != 0)
+        dirty_ = true;
+}
+
+Cost Graph::link_cost(NodeId u, NodeId v) const
+{
+    auto it = links_.find(key(u, v));
+    return it == links_.end() ? kInfinity : it->second;
+}
+
+bool Graph::patch_cost(NodeId u, NodeId v, Cost cost)
+{
+    const NodeId* first = targets_ + offsets_[u];
+    const NodeId* last = targets_ + offsets_[u + 1];
+    const NodeId* it
+        = std::lower_bound(first, last, v, [&](NodeId a, NodeId b) { return rank(a) < rank(b); });
+    if (it == last || *it != v)
+        return false;
+    costs_[it - targets_] = cost;
+    return true;
+}
+
+void Graph::rank_neighbours(std::vector<NodeId> rank)
+{
+    rank_ = std::move(rank);
+    dirty_ = true;
+}
+
+void Graph::build(Arena& scratch)
+{
+    if (!dirty_)
+        return;
+    DV_SCOPE("graph build");
+    dirty_ = false;
+
+    storage_.reset();
+    const std::size_t half_edges = links_.size() * 2;
+    offsets_ = storage_.allocate_array<std::uint32_t>(node_count_ + 1);
+    targets_ = storage_.allocate_array<NodeId>(half_edges);
+    costs_ = storage_.allocate_array<Cost>(half_edges);
+
+    std::fill_n(offsets_, node_count_ + 1, 0);
+    for (const auto& [k, cost] : links_) {
+        ++offsets_[(k >> 32) + 1];
+        ++offsets_[static_cast<NodeId>(k) + 1];
+    }
+    std::uint32_t max_degree = 0;
+    for (NodeId x = 0; x < node_count_; ++x) {
+        max_degree = std::max(max_degree, offsets_[x + 1]);
+        offsets_[x + 1] += offsets_[x];
+    }
+
+    auto* fill = scratch.allocate_array<std::uint32_t>(node_count_);
+    std::copy_n(offsets_, node_count_, fill);
+    for (const auto& [k, cost] : links_) {
+        const auto u = static_cast<NodeId>(k >> 32);
+        const auto v = static_cast<NodeId>(k);
+        targets_[fill[u]] = v;
+        costs_[fill[u]++] = cost;
+        targets_[fill[v]] = u;
+        costs_[fill[v]++] = cost;
+    }
+
+    auto* row = scratch.allocate_array<Neighbour>(max_degree);
+    for (NodeId x = 0; x < node_count_; ++x) {
+        const auto first = offsets_[x], last = offsets_[x + 1];
+        for (auto i = first; i < last; ++i)
+            row[i - first] = {rank(targets_[i]), targets_[i], costs_[i]};
+        std::sort(row, row + (last - first));
+        for (auto i = first; i < last; ++i) {
+            targets_[i] = row[i - first].target;
+            costs_[i] = row[i - first].cost;
+        }
+    }
+}
+
+} // namespace dv
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "arena.hpp"
+#include "cost.hpp"
+#include "names.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace dv {
+
+// Undirected weighted graph over dense node IDs, stored as compressed sparse
+// rows: the neighbours of x are targets()[offset(x)..offset(x + 1)), sorted
+// by ID or by rank_neighbours(), with the matching link costs in costs().
+//
+// Link changes are staged with set_link()/remove_link() and take effect at
+// the next build(). A cost change on an existing link is patched in place;
+// adding or removing links rebuilds the rows. The rows live in the graph's
+// own long-lived arena, which is recycled on each rebuild.
+class Graph {
+public:
+    explicit Graph(NodeId node_count = 0);
+    Graph(Graph&&) = default;
+    Graph& operator=(Graph&&) = default;
+
+    NodeId node_count() const { return node_count_; }
+
+    // Self-links are ignored.
+    void set_link(NodeId u, NodeId v, Cost cost);
+    void remove_link(NodeId u, NodeId v);
+
+    // Sorts neighbours by rank[ID] instead of ID from the next build(), so
+    // renumbered routers keep their neighbours in declaration order.
+    void rank_neighbours(std::vector<NodeId> rank);
+
+    // Build temporaries come from scratch, which is left for the caller to
+    // reset.
+    void build(Arena& scratch);
+
+    // Cost of the staged link between u and v, kInfinity if there is none.
+    Cost link_cost(NodeId u, NodeId v) const;
+
+    std::uint32_t offset(NodeId x) const { return offsets_[x]; }
+    std::uint32_t degree(NodeId x) const { return offsets_[x + 1] - offsets_[x]; }
+    const NodeId* targets() const { return targets_; }
+    const Cost* costs() const { return costs_; }
+
+    const Arena& storage() const { return storage_; }
+
+private:
+    static std::uint64_t key(NodeId u, NodeId v);
+    bool patch_cost(NodeId u, NodeId v, Cost cost);
+    NodeId rank(NodeId x) const { return rank_.empty() ? x : rank_[x]; }
+
+    NodeId node_count_;
+    std::vector<NodeId> rank_;
+    std::unordered_map<std::uint64_t, Cost> links_;
+    bool dirty_ = true;
+
+    Arena storage_;
+    std::uint32_t* offsets_ = nullptr;
+    NodeId* targets_ = nullptr;
+    Cost* costs_ = nullptr;
+};
+
+} // namespace dv
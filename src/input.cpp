@@ -0,0 +1,190 @@
+#include "input.hpp"
+
+#include "instrument.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace dv {
+
+namespace {
+
+bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+// Walks the buffer one stripped line at a time without copying.
+class LineScanner {
+public:
+    explicit LineScanner(std::string_view text)
+        : pos_(text.data())
+        , end_(text.data() + text.size())
+    {
+    }
+
+    bool next(std::string_view& line)
+    {
+        if (pos_ == end_)
+            return false;
+        const char* first = pos_;
+        const char* nl = static_cast<const char*>(
+            std::memchr(first, '\n', static_cast<std::size_t>(end_ - first)));
+        const char* last = nl ? nl : end_;
+        pos_ = nl ? nl + 1 : end_;
+
+        while (first < last && is_space(*first))
+            ++first;
+        while (last > first && is_space(last[-1]))
+            --last;
+        line = std::string_view(first, static_cast<std::size_t>(last - first));
+        return true;
+    }
+
+private:
+    const char* pos_;
+    const char* end_;
+};
+
+std::string_view next_field(std::string_view& rest)
+{
+    std::size_t i = 0;
+    while (i < rest.size() && is_space(rest[i]))
+        ++i;
+    std::size_t j = i;
+    while (j < rest.size() && !is_space(rest[j]))
+        ++j;
+    std::string_view field = rest.substr(i, j - i);
+    rest.remove_prefix(j);
+    return field;
+}
+
+// Accepts -1 (link removal) and 0..kMaxLinkCost.
+bool parse_cost(std::string_view field, Cost& cost)
+{
+    bool negative = false;
+    if (!field.empty() && (field[0] == '-' || field[0] == '+')) {
+        negative = field[0] == '-';
+        field.remove_prefix(1);
+    }
+    if (field.empty())
+        return false;
+    Cost value = 0;
+    for (char c : field) {
+        if (c < '0' || c > '9')
+            return false;
+        if (value > (kMaxLinkCost - (c - '0')) / 10)
+            return false;
+        value = value * 10 + (c - '0');
+    }
+    if (negative && value != 1)
+        return false;
+    cost = negative ? -value : value;
+    return true;
+}
+
+// Accepts milliseconds above zero, up to kMaxDelay, with at most three
+// decimals.
+bool parse_delay(std::string_view field, Delay& delay)
+{
+    std::uint64_t micros = 0;
+    int decimals = -1;
+    for (char c : field) {
+        if (c == '.' && decimals < 0) {
+            decimals = 0;
+            continue;
+        }
+        if (c < '0' || c > '9' || decimals == 3)
+            return false;
+        micros = micros * 10 + static_cast<std::uint64_t>(c - '0');
+        if (micros > kMaxDelay)
+            return false;
+        if (decimals >= 0)
+            ++decimals;
+    }
+    if (field.empty() || field.back() == '.')
+        return false;
+    for (int d = std::max(decimals, 0); d < 3; ++d)
+        micros *= 10;
+    if (micros == 0 || micros > kMaxDelay)
+        return false;
+    delay = static_cast<Delay>(micros);
+    return true;
+}
+
+[[noreturn]] void malformed(std::string_view line)
+{
+    throw std::runtime_error("malformed link line '" + std::string(line) + "'");
+}
+
+LinkLine parse_link(std::string_view line, const NameTable& names, bool allow_removal)
+{
+    std::string_view rest = line;
+    std::string_view a = next_field(rest);
+    std::string_view b = next_field(rest);
+    std::string_view c = next_field(rest);
+    std::string_view d = next_field(rest);
+    Cost cost;
+    Delay delay = kNoDelay;
+    if (c.empty() || !next_field(rest).empty() || !parse_cost(c, cost) || (cost < 0 && !allow_removal)
+        || (!d.empty() && !parse_delay(d, delay)))
+        malformed(line);
+    return LinkLine{names.lookup(a), names.lookup(b), cost, delay};
+}
+
+} // namespace
+
+Topology parse_input(std::string_view text)
+{
+    DV_SCOPE("parse");
+    Topology topo;
+    LineScanner lines(text);
+    std::string_view line;
+
+    while (true) {
+        if (!lines.next(line))
+            throw std::runtime_error("unexpected end of input before START");
+        if (line == "START")
+            break;
+        topo.names.add(line);
+    }
+    topo.names.build_index();
+
+    while (true) {
+        if (!lines.next(line))
+            throw std::runtime_error("unexpected end of input before UPDATE");
+        if (line == "UPDATE")
+            break;
+        topo.links.push_back(parse_link(line, topo.names, false));
+    }
+
+    // END is optional; a missing terminator or blank line ends the section.
+    while (lines.next(line) && !line.empty() && line != "END")
+        topo.updates.push_back(parse_link(line, topo.names, true));
+
+    return topo;
+}
+
+std::vector<LinkLine> parse_updates(std::string_view text, const NameTable& names)
+{
+    DV_SCOPE("parse");
+    std::vector<LinkLine> updates;
+    LineScanner lines(text);
+    std::string_view line;
+    bool first = true;
+    while (lines.next(line) && !line.empty() && line != "END") {
+        if (!first || line != "UPDATE")
+            updates.push_back(parse_link(line, names, true));
+        first = false;
+    }
+    return updates;
+}
+
+LinkLine parse_update(std::string_view line, const NameTable& names)
+{
+    return parse_link(line, names, true);
+}
+
+} // namespace dv
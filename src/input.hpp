@@ -0,0 +1,52 @@
+#pragma once
+
+#include "graph.hpp"
+#include "names.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace dv {
+
+// Propagation delay of a link in microseconds, used only by --simulate.
+using Delay = std::uint32_t;
+constexpr Delay kNoDelay = 0;          // none given on the line
+constexpr Delay kDefaultDelay = 1000;  // 1 ms
+constexpr Delay kMaxDelay = 1000000000; // 1000 s
+
+// One "A B cost [delay]" line, the delay in milliseconds with up to three
+// decimals. In the UPDATE section a cost of -1 removes the link.
+struct LinkLine {
+    NodeId a;
+    NodeId b;
+    Cost cost;
+    Delay delay = kNoDelay;
+};
+
+// The three sections of the START/UPDATE/END stdin protocol. Router names
+// are interned as the pre-START block is read, so link lines are stored by ID.
+struct Topology {
+    NameTable names;
+    std::vector<LinkLine> links;
+    std::vector<LinkLine> updates;
+
+    // Where each router was declared, once renumber() has given them other
+    // IDs; empty while IDs are declaration order. Output follows it.
+    std::vector<NodeId> rank;
+};
+
+// Tokenizes the input in place; only router names are copied. Throws
+// std::runtime_error on malformed input.
+Topology parse_input(std::string_view text);
+
+// Parses an UPDATE section on its own, as given to a run that starts from
+// a snapshot: link lines up to END or a blank line, optionally preceded
+// by UPDATE. Throws std::runtime_error on malformed lines.
+std::vector<LinkLine> parse_updates(std::string_view text, const NameTable& names);
+
+// Parses one UPDATE-section line against the declared routers. Throws
+// std::runtime_error if it is malformed or names an unknown router.
+LinkLine parse_update(std::string_view line, const NameTable& names);
+
+} // namespace dv
@@ -0,0 +1,111 @@
+#include "input_source.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dv {
+
+namespace {
+
+constexpr std::size_t kBlockSize = std::size_t(1) << 20;
+
+[[noreturn]] void fail(const std::string& what)
+{
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+InputSource InputSource::open(const char* path)
+{
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        fail(std::string("cannot open ") + path);
+    try {
+        InputSource src = from_fd(fd);
+        ::close(fd);
+        return src;
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+InputSource InputSource::from_fd(int fd)
+{
+    InputSource src;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            madvise(p, st.st_size, MADV_SEQUENTIAL);
+            src.data_ = static_cast<const char*>(p);
+            src.size_ = static_cast<std::size_t>(st.st_size);
+            src.mapped_ = true;
+            return src;
+        }
+    }
+
+    std::size_t used = 0;
+    while (true) {
+        if (src.buffer_.size() - used < kBlockSize)
+            src.buffer_.resize(used + kBlockSize);
+        ssize_t got = ::read(fd, src.buffer_.data() + used, src.buffer_.size() - used);
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            fail("cannot read input");
+        }
+        if (got == 0)
+            break;
+        used += static_cast<std::size_t>(got);
+    }
+    src.buffer_.resize(used);
+    src.data_ = src.buffer_.data();
+    src.size_ = used;
+    return src;
+}
+
+InputSource::InputSource(InputSource&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+InputSource& InputSource::operator=(InputSource&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        buffer_ = std::move(other.buffer_);
+        mapped_ = std::exchange(other.mapped_, false);
+        size_ = std::exchange(other.size_, 0);
+        data_ = std::exchange(other.data_, nullptr);
+        if (!mapped_)
+            data_ = buffer_.data();
+    }
+    return *this;
+}
+
+InputSource::~InputSource()
+{
+    release();
+}
+
+void InputSource::release()
+{
+    if (mapped_)
+        munmap(const_cast<char*>(data_), size_);
+    mapped_ = false;
+    data_ = nullptr;
+    size_ = 0;
+}
+
+} // namespace dv
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace dv {
+
+// The whole input as one contiguous read-only buffer. Regular files are
+// memory-mapped; pipes and terminals are drained in large blocks.
+class InputSource {
+public:
+    // Throws std::runtime_error if the file cannot be opened or read.
+    static InputSource open(const char* path);
+    static InputSource from_fd(int fd);
+
+    InputSource(InputSource&& other) noexcept;
+    InputSource& operator=(InputSource&& other) noexcept;
+    InputSource(const InputSource&) = delete;
+    InputSource& operator=(const InputSource&) = delete;
+    ~InputSource();
+
+    std::string_view text() const { return {data_, size_}; }
+
+private:
+    InputSource() = default;
+    void release();
+
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<char> buffer_;
+};
+
+} // namespace dv
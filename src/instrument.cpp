@@ -0,0 +1,137 @@
+#include "instrument.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace dv::instrument {
+
+namespace {
+
+struct Event {
+    const char* name;
+    std::int64_t arg;
+    Clock::time_point begin;
+    Clock::time_point end;
+};
+
+// One per thread that records anything. Logs are owned by the registry,
+// not the thread, so pool workers' data outlive the pool.
+struct ThreadLog {
+    unsigned tid;
+    std::vector<Event> events;
+    std::uint64_t counters[static_cast<std::size_t>(Counter::count)] = {};
+};
+
+const char* const kCounterNames[] = {"relaxations", "entries_changed", "advertisements"};
+static_assert(std::size(kCounterNames) == static_cast<std::size_t>(Counter::count));
+
+const Clock::time_point kEpoch = Clock::now();
+
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<ThreadLog>> registry;
+
+ThreadLog& local_log()
+{
+    thread_local ThreadLog* log = nullptr;
+    if (log == nullptr) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.push_back(std::make_unique<ThreadLog>());
+        log = registry.back().get();
+        log->tid = static_cast<unsigned>(registry.size());
+    }
+    return *log;
+}
+
+double micros(Clock::duration d)
+{
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+std::ofstream open_report(const std::string& path)
+{
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error("cannot write '" + path + "'");
+    out << std::fixed << std::setprecision(3);
+    return out;
+}
+
+} // namespace
+
+void record(const char* name, std::int64_t arg, Clock::time_point begin, Clock::time_point end)
+{
+    local_log().events.push_back({name, arg, begin, end});
+}
+
+void add(Counter counter, std::uint64_t n)
+{
+    local_log().counters[static_cast<std::size_t>(counter)] += n;
+}
+
+void write_summary(const std::string& path)
+{
+    struct Phase {
+        std::string name;
+        Clock::time_point first;
+        std::uint64_t calls = 0;
+        Clock::duration total{};
+        Clock::duration longest{};
+    };
+    std::vector<Phase> phases;
+    std::uint64_t counters[static_cast<std::size_t>(Counter::count)] = {};
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (const auto& log : registry) {
+        for (const Event& e : log->events) {
+            auto it = std::find_if(phases.begin(), phases.end(), [&](const Phase& p) { return p.name == e.name; });
+            if (it == phases.end())
+                it = phases.insert(phases.end(), Phase{e.name, e.begin});
+            it->first = std::min(it->first, e.begin);
+            ++it->calls;
+            it->total += e.end - e.begin;
+            it->longest = std::max(it->longest, e.end - e.begin);
+        }
+        for (std::size_t c = 0; c < std::size(counters); ++c)
+            counters[c] += log->counters[c];
+    }
+    std::sort(phases.begin(), phases.end(), [](const Phase& a, const Phase& b) { return a.first < b.first; });
+
+    std::ofstream out = open_report(path);
+    out << "{\n  \"phases\": [";
+    for (std::size_t i = 0; i < phases.size(); ++i) {
+        const Phase& p = phases[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << p.name << "\", \"calls\": " << p.calls
+            << ", \"total_us\": " << micros(p.total) << ", \"max_us\": " << micros(p.longest) << '}';
+    }
+    out << "\n  ],\n  \"counters\": {";
+    for (std::size_t c = 0; c < std::size(counters); ++c)
+        out << (c ? ",\n" : "\n") << "    \"" << kCounterNames[c] << "\": " << counters[c];
+    out << "\n  }\n}\n";
+}
+
+void write_trace(const std::string& path)
+{
+    std::ofstream out = open_report(path);
+    out << "{\"traceEvents\": [";
+    bool first = true;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (const auto& log : registry) {
+        for (const Event& e : log->events) {
+            out << (first ? "\n" : ",\n") << "{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                << log->tid << ", \"ts\": " << micros(e.begin - kEpoch) << ", \"dur\": " << micros(e.end - e.begin);
+            if (e.arg >= 0)
+                out << ", \"args\": {\"n\": " << e.arg << '}';
+            out << '}';
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+}
+
+} // namespace dv::instrument
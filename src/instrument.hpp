@@ -0,0 +1,75 @@
+#pragma once
+
+// Optional phase timers and work counters, enabled by configuring with
+// -DDV_INSTRUMENT=ON. When disabled, the DV_* macros expand to nothing and
+// their arguments are never evaluated.
+//
+//     DV_SCOPE("round");           // times the enclosing block
+//     DV_SCOPE_ARG("round", t);    // the same, tagged with a number
+//     DV_COUNT(relaxations, n);    // adds n to a counter
+//
+// Timings and counts are kept per thread, so recording takes no lock, and
+// are merged when a report is written.
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace dv::instrument {
+
+#if DV_INSTRUMENT
+constexpr bool kEnabled = true;
+#else
+constexpr bool kEnabled = false;
+#endif
+
+enum class Counter {
+    relaxations,     // table entries relaxed against a neighbour's vector
+    entries_changed, // vector entries whose cost or next hop changed
+    advertisements,  // changed vectors sent, per neighbour
+    count,
+};
+
+using Clock = std::chrono::steady_clock;
+
+void record(const char* name, std::int64_t arg, Clock::time_point begin, Clock::time_point end);
+void add(Counter counter, std::uint64_t n);
+
+// Times its own lifetime.
+class Scope {
+public:
+    explicit Scope(const char* name, std::int64_t arg = -1)
+        : name_(name)
+        , arg_(arg)
+        , begin_(Clock::now())
+    {
+    }
+    ~Scope() { record(name_, arg_, begin_, Clock::now()); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name_;
+    std::int64_t arg_;
+    Clock::time_point begin_;
+};
+
+// Per-phase call counts and total times plus the counters, as JSON.
+void write_summary(const std::string& path);
+// Every timed scope as a Chrome trace (chrome://tracing, Perfetto).
+void write_trace(const std::string& path);
+
+} // namespace dv::instrument
+
+#if DV_INSTRUMENT
+#define DV_INSTRUMENT_CONCAT2(a, b) a##b
+#define DV_INSTRUMENT_CONCAT(a, b) DV_INSTRUMENT_CONCAT2(a, b)
+#define DV_SCOPE(name) ::dv::instrument::Scope DV_INSTRUMENT_CONCAT(dv_scope_, __LINE__)(name)
+#define DV_SCOPE_ARG(name, arg) \
+    ::dv::instrument::Scope DV_INSTRUMENT_CONCAT(dv_scope_, __LINE__)(name, arg)
+#define DV_COUNT(counter, n) ::dv::instrument::add(::dv::instrument::Counter::counter, n)
+#else
+#define DV_SCOPE(name) static_cast<void>(0)
+#define DV_SCOPE_ARG(name, arg) static_cast<void>(0)
+#define DV_COUNT(counter, n) static_cast<void>(0)
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "table_file.hpp"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <sys/mman.h>
+
+namespace dv {
+
+// Zero-filled array reserved as address space only: each page is
+// committed the first time it is touched, so an array of which a process
+// uses a few rows costs memory for just those rows. Given a TableFile,
+// the pages are the file's instead, and so can be written back and
+// evicted rather than held in memory.
+template <typename T>
+class LazyArray {
+    static_assert(std::is_trivial_v<T>);
+
+public:
+    LazyArray() = default;
+    explicit LazyArray(std::size_t count, TableFile* file = nullptr)
+        : bytes_(count * sizeof(T))
+        , file_backed_(file != nullptr)
+    {
+        if (bytes_ == 0)
+            return;
+        if (file != nullptr) {
+            data_ = static_cast<T*>(file->map(bytes_));
+            return;
+        }
+        void* p = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+        data_ = static_cast<T*>(p);
+    }
+
+    LazyArray(LazyArray&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , bytes_(std::exchange(other.bytes_, 0))
+        , file_backed_(other.file_backed_)
+    {
+    }
+    LazyArray& operator=(LazyArray&& other) noexcept
+    {
+        if (this != &other) {
+            release();
+            data_ = std::exchange(other.data_, nullptr);
+            bytes_ = std::exchange(other.bytes_, 0);
+            file_backed_ = other.file_backed_;
+        }
+        return *this;
+    }
+    LazyArray(const LazyArray&) = delete;
+    LazyArray& operator=(const LazyArray&) = delete;
+    ~LazyArray() { release(); }
+
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+
+private:
+    void release()
+    {
+        if (data_ != nullptr) {
+            if (file_backed_)
+                TableFile::discard(data_, bytes_);
+            munmap(data_, bytes_);
+        }
+        data_ = nullptr;
+        bytes_ = 0;
+    }
+
+    T* data_ = nullptr;
+    std::size_t bytes_ = 0;
+    bool file_backed_ = false;
+};
+
+} // namespace dv
@@ -0,0 +1,113 @@
+#include "line_stream.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+namespace dv {
+
+namespace {
+
+constexpr std::size_t kReadSize = std::size_t(1) << 16;
+
+bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+std::string_view strip(const char* first, const char* last)
+{
+    while (first < last && is_space(*first))
+        ++first;
+    while (last > first && is_space(last[-1]))
+        --last;
+    return std::string_view(first, static_cast<std::size_t>(last - first));
+}
+
+} // namespace
+
+LineStream::LineStream(int fd)
+    : fd_(fd)
+    , buf_(kReadSize)
+{
+}
+
+bool LineStream::fill()
+{
+    if (begin_ > 0) {
+        std::memmove(buf_.data(), buf_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+    }
+    if (buf_.size() - end_ < kReadSize)
+        buf_.resize(end_ + kReadSize);
+    while (true) {
+        ssize_t got = ::read(fd_, buf_.data() + end_, buf_.size() - end_);
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("cannot read input: ") + std::strerror(errno));
+        }
+        if (got == 0) {
+            eof_ = true;
+            return false;
+        }
+        end_ += static_cast<std::size_t>(got);
+        return true;
+    }
+}
+
+bool LineStream::next_line(std::string_view& line)
+{
+    const char* first = buf_.data() + begin_;
+    const char* last = buf_.data() + end_;
+    const char* nl = static_cast<const char*>(std::memchr(first, '\n', end_ - begin_));
+    if (nl != nullptr) {
+        begin_ = static_cast<std::size_t>(nl + 1 - buf_.data());
+        line = strip(first, nl);
+        return true;
+    }
+    // An unterminated last line still counts once the input has ended.
+    if (eof_ && first < last) {
+        begin_ = end_;
+        line = strip(first, last);
+        return true;
+    }
+    return false;
+}
+
+bool LineStream::next_batch(std::vector<std::string_view>& lines)
+{
+    lines.clear();
+    while (true) {
+        std::string_view line;
+        while (next_line(line))
+            lines.push_back(line);
+        if (!lines.empty())
+            return true;
+        if (eof_)
+            return false;
+        fill();
+    }
+}
+
+bool LineStream::read_until(std::string_view stop, std::string& text)
+{
+    while (true) {
+        std::string_view line;
+        while (next_line(line)) {
+            text.append(line);
+            text.push_back('\n');
+            if (line == stop)
+                return true;
+        }
+        if (eof_)
+            return false;
+        fill();
+    }
+}
+
+} // namespace dv
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dv {
+
+// Reads a descriptor that keeps producing lines, such as a pipe fed by a
+// monitoring process, and hands them out in batches: each call returns
+// every complete line that has arrived, blocking only while there is none.
+class LineStream {
+public:
+    explicit LineStream(int fd);
+
+    // Replaces lines with the next batch, stripped of surrounding space;
+    // the views stay valid until the next call. Returns false once the
+    // input has ended and every line has been returned. Throws
+    // std::runtime_error if the descriptor cannot be read.
+    bool next_batch(std::vector<std::string_view>& lines);
+
+    // Reads single lines up to and including the first equal to stop,
+    // appending each with its newline to text; lines after it are left
+    // for next_batch(). Returns false if the input ends first.
+    bool read_until(std::string_view stop, std::string& text);
+
+private:
+    // Reads once, after moving unconsumed bytes to the front; returns
+    // false at end of input.
+    bool fill();
+    bool next_line(std::string_view& line);
+
+    int fd_;
+    std::vector<char> buf_;
+    std::size_t begin_ = 0; // first unconsumed byte
+    std::size_t end_ = 0;   // one past the last byte read
+    bool eof_ = false;
+};
+
+} // namespace dv
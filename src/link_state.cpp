@@ -0,0 +1,222 @@
+#include "link_state.hpp"
+
+#include "instrument.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+namespace dv {
+
+namespace {
+
+using Distance = std::int64_t; // path sums can exceed a Cost
+constexpr Distance kUnreached = std::numeric_limits<Distance>::max();
+
+// Destinations searched together; their entries in a router's row fill
+// one cache line.
+constexpr NodeId kBlock = 16;
+
+// Monotone priority queue for Dijkstra's integer keys. Bucket i holds
+// entries whose key first differs from the last key popped in bit i - 1,
+// so an entry is moved at most once per bit on its way to bucket 0, and
+// buckets are never sorted. Stale entries are left in place and skipped by
+// the caller instead of being decreased.
+class RadixHeap {
+public:
+    bool empty() const { return size_ == 0; }
+
+    void push(Distance key, NodeId node)
+    {
+        buckets_[bucket(key)].push_back({key, node});
+        ++size_;
+    }
+
+    // Removes a minimal entry; the heap must not be empty.
+    void pop(Distance& key, NodeId& node)
+    {
+        if (buckets_[0].empty()) {
+            std::size_t i = 1;
+            while (buckets_[i].empty())
+                ++i;
+            std::vector<Entry>& from = buckets_[i];
+            last_ = std::min_element(from.begin(), from.end(), [](const Entry& a, const Entry& b) {
+                return a.key < b.key;
+            })->key;
+            for (const Entry& entry : from)
+                buckets_[bucket(entry.key)].push_back(entry);
+            from.clear();
+        }
+        const Entry entry = buckets_[0].back();
+        buckets_[0].pop_back();
+        --size_;
+        key = entry.key;
+        node = entry.node;
+    }
+
+    // Empties the heap for a new search, keeping its buffers.
+    void reset()
+    {
+        for (auto& b : buckets_)
+            b.clear();
+        size_ = 0;
+        last_ = 0;
+    }
+
+private:
+    struct Entry {
+        Distance key;
+        NodeId node;
+    };
+
+    std::size_t bucket(Distance key) const
+    {
+        const auto diff = static_cast<std::uint64_t>(key ^ last_);
+        return diff == 0 ? 0 : 64 - static_cast<std::size_t>(__builtin_clzll(diff));
+    }
+
+    std::vector<Entry> buckets_[65];
+    std::size_t size_ = 0;
+    Distance last_ = 0;
+};
+
+// Costs from every router to one destination.
+void dijkstra(const Graph& net, NodeId dest, RadixHeap& heap, std::vector<Distance>& dist)
+{
+    const NodeId* targets = net.targets();
+    const Cost* costs = net.costs();
+    std::fill(dist.begin(), dist.end(), kUnreached);
+    dist[dest] = 0;
+    heap.reset();
+    heap.push(0, dest);
+    while (!heap.empty()) {
+        Distance key;
+        NodeId u;
+        heap.pop(key, u);
+        if (key != dist[u])
+            continue;
+        for (auto e = net.offset(u), end = net.offset(u + 1); e < end; ++e) {
+            const Distance d = dist[u] + costs[e];
+            if (d < dist[targets[e]]) {
+                dist[targets[e]] = d;
+                heap.push(d, targets[e]);
+            }
+        }
+    }
+}
+
+// Checks router x's route to the destination whose costs are in dist;
+// fills found with both sides either way.
+bool check_route(const Graph& net, NodeId x, NodeId y, const RouteRow& row, const std::vector<Distance>& dist,
+                 Cost infinity, bool exact_hops, RouteMismatch& found)
+{
+    found = {x, y, row.dist[y], row.via[y], kInfinity, kNoNode};
+    if (dist[x] >= infinity)
+        return found.cost >= kInfinity;
+
+    const NodeId* targets = net.targets();
+    const Cost* costs = net.costs();
+    found.expected_cost = static_cast<Cost>(dist[x]);
+    bool via_on_path = false;
+    for (auto e = net.offset(x), end = net.offset(x + 1); e < end; ++e) {
+        const NodeId v = targets[e];
+        if (dist[v] == kUnreached || costs[e] + dist[v] != dist[x])
+            continue;
+        if (found.expected_via == kNoNode)
+            found.expected_via = v;
+        via_on_path |= v == found.via;
+    }
+    return found.cost == found.expected_cost
+        && (exact_hops ? found.via == found.expected_via : via_on_path);
+}
+
+} // namespace
+
+LinkState::LinkState(const Topology& topo, unsigned threads)
+    : net_(topo.names.size())
+{
+    if (!topo.rank.empty())
+        net_.rank_neighbours(topo.rank);
+    for (const auto& link : topo.links)
+        net_.set_link(link.a, link.b, link.cost);
+    net_.build(scratch_);
+    scratch_.reset();
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    pool_ = std::make_unique<ThreadPool>(threads);
+}
+
+void LinkState::apply_updates(const std::vector<LinkLine>& updates)
+{
+    for (const auto& link : updates) {
+        if (link.cost == -1)
+            net_.remove_link(link.a, link.b);
+        else
+            net_.set_link(link.a, link.b, link.cost);
+    }
+    net_.build(scratch_);
+    scratch_.reset();
+}
+
+VerifyReport LinkState::verify(const std::vector<RouteRow>& rows, Cost infinity,
+                               std::size_t max_examples)
+{
+    DV_SCOPE("verify");
+    const NodeId n = net_.node_count();
+    const Cost* costs = net_.costs();
+
+    // With a zero-cost link, poisoning can legitimately settle on a later
+    // neighbour than the first on a shortest path, so only require the
+    // next hop to be on one.
+    const bool exact_hops = std::find(costs, costs + net_.offset(n), 0) == costs + net_.offset(n);
+
+    // Destinations go in blocks so each router's entries for a block share
+    // a cache line; walking one destination's column alone would miss the
+    // cache on every router.
+    const std::size_t blocks = (n + kBlock - 1) / kBlock;
+    std::vector<VerifyReport> shards(pool_->size());
+    pool_->run(blocks, [&](std::size_t begin, std::size_t end, unsigned index) {
+        VerifyReport& report = shards[index];
+        RadixHeap heap;
+        std::vector<Distance> dist[kBlock];
+        for (auto& column : dist)
+            column.resize(n);
+        for (std::size_t block = begin; block < end; ++block) {
+            const NodeId first = static_cast<NodeId>(block * kBlock);
+            const NodeId count = std::min<NodeId>(kBlock, n - first);
+            for (NodeId k = 0; k < count; ++k)
+                dijkstra(net_, first + k, heap, dist[k]);
+            for (NodeId x = 0; x < n; ++x) {
+                for (NodeId k = 0; k < count; ++k) {
+                    const NodeId y = first + k;
+                    if (x == y)
+                        continue;
+                    ++report.routes;
+                    RouteMismatch found;
+                    if (!check_route(net_, x, y, rows[x], dist[k], infinity, exact_hops, found)
+                        && report.mismatches++ < max_examples)
+                        report.examples.push_back(found);
+                }
+            }
+        }
+    });
+
+    // Shards cover ascending block ranges, so the first examples overall
+    // are the first of the shards' in order, whatever the thread count.
+    VerifyReport total;
+    for (const VerifyReport& shard : shards) {
+        total.routes += shard.routes;
+        total.mismatches += shard.mismatches;
+        for (const RouteMismatch& m : shard.examples) {
+            if (total.examples.size() < max_examples)
+                total.examples.push_back(m);
+        }
+    }
+    std::sort(total.examples.begin(), total.examples.end(), [](const RouteMismatch& a, const RouteMismatch& b) {
+        return a.dest != b.dest ? a.dest < b.dest : a.router < b.router;
+    });
+    return total;
+}
+
+} // namespace dv
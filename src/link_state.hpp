@@ -0,0 +1,61 @@
+#pragma once
+
+#include "arena.hpp"
+#include "cost.hpp"
+#include "graph.hpp"
+#include "input.hpp"
+#include "names.hpp"
+#include "route_matrix.hpp"
+#include "thread_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace dv {
+
+// A route that disagrees with the shortest paths.
+struct RouteMismatch {
+    NodeId router;
+    NodeId dest;
+    Cost cost;          // as routed; kInfinity if unreachable
+    NodeId via;
+    Cost expected_cost; // shortest path cost
+    NodeId expected_via;
+};
+
+struct VerifyReport {
+    std::uint64_t routes = 0;     // router and destination pairs checked
+    std::uint64_t mismatches = 0;
+    std::vector<RouteMismatch> examples; // a few of them, by destination then router
+};
+
+// Link-state cross-check for the distance-vector engine. It keeps its own
+// copy of the graph, built from the same input, and computes converged
+// routes directly: one Dijkstra per destination over a radix heap, with
+// destinations sharded across a thread pool.
+//
+// Links are symmetric, so the search from destination y yields every
+// router's cost to y. The expected next hop is the first neighbour, in
+// declaration order, on a shortest path, which is where the engine's
+// strict-less tie-break settles.
+class LinkState {
+public:
+    explicit LinkState(const Topology& topo, unsigned threads = 1);
+
+    void apply_updates(const std::vector<LinkLine>& updates);
+
+    // Compares rows[x] for every router x against the shortest paths, with
+    // costs at or above infinity unreachable. At most max_examples
+    // mismatches are kept.
+    VerifyReport verify(const std::vector<RouteRow>& rows, Cost infinity,
+                        std::size_t max_examples = 10);
+
+private:
+    Graph net_;
+    Arena scratch_;
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace dv
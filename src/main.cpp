@@ -0,0 +1,509 @@
+#include "cluster.hpp"
+#include "engine.hpp"
+#include "event_sim.hpp"
+#include "input.hpp"
+#include "input_source.hpp"
+#include "instrument.hpp"
+#include "line_stream.hpp"
+#include "link_state.hpp"
+#include "minplus.hpp"
+#include "options.hpp"
+#include "output_writer.hpp"
+#include "partition.hpp"
+#include "reorder.hpp"
+#include "scenarios.hpp"
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+std::string_view hop_name(const dv::NameTable& names, dv::NodeId hop)
+{
+    return hop == dv::kNoNode ? std::string_view("INF") : std::string_view(names.name(hop));
+}
+
+// Cross-checks routing tables against shortest paths; throws if any route
+// differs.
+void verify(dv::LinkState& reference, const std::vector<dv::RouteRow>& rows, const dv::Topology& topo,
+            dv::Cost infinity, dv::OutputWriter& out)
+{
+    const dv::VerifyReport report = reference.verify(rows, infinity);
+    out.flush();
+    if (report.mismatches == 0) {
+        std::cerr << "verify: all " << report.routes << " routes match shortest paths\n";
+        return;
+    }
+    auto cost_text = [](dv::Cost cost) {
+        return cost >= dv::kInfinity ? std::string("INF") : std::to_string(cost);
+    };
+    for (const dv::RouteMismatch& m : report.examples) {
+        std::cerr << "verify: " << topo.names.name(m.router) << " to " << topo.names.name(m.dest)
+                  << ": routed " << cost_text(m.cost) << " via " << hop_name(topo.names, m.via)
+                  << ", shortest " << cost_text(m.expected_cost) << " via "
+                  << hop_name(topo.names, m.expected_via) << '\n';
+    }
+    throw std::runtime_error(std::to_string(report.mismatches) + " of " + std::to_string(report.routes)
+                             + " routes differ from shortest paths");
+}
+
+// The same for the engine's. The reference reads whole Cost rows, so
+// tables are widened and made dense for the rest of the run.
+template <typename Policy>
+void verify(dv::LinkState& reference, dv::Engine<Policy>& engine, const dv::Topology& topo,
+            dv::Cost infinity, dv::OutputWriter& out)
+{
+    engine.widen_tables();
+    engine.make_dense();
+    std::vector<dv::RouteRow> rows(topo.names.size());
+    for (dv::NodeId x = 0; x < rows.size(); ++x)
+        rows[x] = {engine.route_costs(x), engine.next_hops(x)};
+    verify(reference, rows, topo, infinity, out);
+}
+
+// The routers named in --query, or none for all of them; throws
+// std::runtime_error on an unknown name.
+std::vector<dv::NodeId> query_routers(const dv::NameTable& names, std::string_view list)
+{
+    std::vector<dv::NodeId> routers;
+    while (!list.empty()) {
+        const std::size_t comma = std::min(list.find(','), list.size());
+        const std::string_view name = list.substr(0, comma);
+        if (name.empty())
+            throw std::runtime_error("empty router name in --query");
+        routers.push_back(names.lookup(name));
+        list.remove_prefix(std::min(comma + 1, list.size()));
+    }
+    return routers;
+}
+
+struct LiveStats {
+    std::uint64_t batches = 0;
+    std::uint64_t updates = 0;
+    std::chrono::nanoseconds total{};
+    std::chrono::nanoseconds longest{};
+};
+
+// Live mode: applies each batch of link changes from feed as it arrives,
+// reconverges from the resident state and prints the routes that moved.
+// Malformed lines are reported and skipped; END or end of input stops.
+template <typename Policy>
+LiveStats follow(dv::Engine<Policy>& engine, const dv::Topology& topo, const dv::Options& opts, int t,
+                 dv::LineStream& feed, dv::LinkState* reference, dv::OutputWriter& out)
+{
+    LiveStats live;
+    // The delta formats have written every change by the end of a batch.
+    const bool deltas = opts.format != dv::OutputFormat::text;
+    if (!deltas)
+        engine.record_route_changes();
+    std::vector<std::string_view> lines;
+    std::vector<dv::LinkLine> batch;
+    bool ended = false;
+    while (!ended && feed.next_batch(lines)) {
+        const auto start = std::chrono::steady_clock::now();
+        batch.clear();
+        for (std::string_view line : lines) {
+            if (line == "END") {
+                ended = true;
+                break;
+            }
+            if (line.empty())
+                continue;
+            try {
+                batch.push_back(dv::parse_update(line, topo.names));
+            } catch (const std::runtime_error& e) {
+                out.flush();
+                std::cerr << "DistanceVector: ignoring update: " << e.what() << '\n';
+            }
+        }
+        if (batch.empty())
+            continue;
+
+        engine.apply_updates(batch);
+        if (opts.async)
+            engine.converge_async();
+        else
+            t = engine.converge(t + 1, out);
+        ++live.batches;
+        live.updates += batch.size();
+        if (!deltas) {
+            out.write("Route changes after update ");
+            out.write_uint(live.batches);
+            out.put(':');
+            out.end_line();
+            engine.print_route_changes(out);
+            out.end_line();
+        }
+        out.flush();
+
+        const auto took = std::chrono::steady_clock::now() - start;
+        live.total += took;
+        live.longest = std::max<std::chrono::nanoseconds>(live.longest, took);
+        if (reference) {
+            reference->apply_updates(batch);
+            verify(*reference, engine, topo, opts.infinity, out);
+        }
+    }
+    return live;
+}
+
+template <typename Policy>
+void run(const dv::Topology& topo, const dv::Options& opts, dv::LineStream* feed, dv::Snapshot snapshot)
+{
+    dv::EngineConfig config;
+    config.incremental = !opts.full_recompute;
+    config.threads = opts.threads;
+    config.tables = opts.tables;
+    config.format = opts.format;
+    config.infinity = opts.infinity;
+    config.stop_counting = opts.stop_counting;
+    config.compact = opts.compact;
+    config.table_dir = opts.table_dir;
+    config.query = query_routers(topo.names, opts.query);
+    std::vector<dv::Scenario> scenarios;
+    if (!opts.scenario_dir.empty())
+        scenarios = dv::list_scenarios(opts.scenario_dir, opts.scenario_output_dir);
+    // A warm start picks up where the saved run stopped, so it prints only
+    // what that run would have printed for the new UPDATE section.
+    const bool warm = snapshot.dist() != nullptr;
+    int t = snapshot.info().round;
+    dv::Engine<Policy> engine(topo, config, std::move(snapshot));
+    dv::OutputWriter out(STDOUT_FILENO);
+
+    std::unique_ptr<dv::LinkState> reference;
+    if (opts.verify)
+        reference = std::make_unique<dv::LinkState>(topo, opts.threads);
+
+    if (!warm) {
+        if (opts.async)
+            engine.converge_async();
+        else
+            t = engine.converge(0, out);
+        engine.print_routing_tables(out);
+    }
+    if (reference)
+        verify(*reference, engine, topo, opts.infinity, out);
+
+    if (engine.apply_updates(topo.updates)) {
+        if (opts.async)
+            engine.converge_async();
+        else
+            t = engine.converge(t + 1, out);
+        engine.print_routing_tables(out);
+        if (reference) {
+            reference->apply_updates(topo.updates);
+            verify(*reference, engine, topo, opts.infinity, out);
+        }
+    }
+
+    // Each scenario continues from here in a process of its own and
+    // prints what an UPDATE section with its lines would.
+    const auto scenarios_start = std::chrono::steady_clock::now();
+    if (!scenarios.empty()) {
+        out.flush();
+        const std::size_t failed = dv::run_scenarios(scenarios, opts.jobs,
+            [&](const dv::Scenario& scenario, dv::OutputWriter& file) {
+                const dv::InputSource input = dv::InputSource::open(scenario.input.c_str());
+                const std::vector<dv::LinkLine> updates = dv::parse_updates(input.text(), topo.names);
+                if (engine.apply_updates(updates)) {
+                    if (opts.async)
+                        engine.converge_async();
+                    else
+                        engine.converge(t + 1, file);
+                    engine.print_routing_tables(file);
+                    if (reference) {
+                        reference->apply_updates(updates);
+                        verify(*reference, engine, topo, opts.infinity, file);
+                    }
+                }
+                return 0;
+            });
+        if (failed != 0)
+            throw std::runtime_error(std::to_string(failed) + " of " + std::to_string(scenarios.size())
+                                     + " scenarios failed");
+    }
+    const auto scenarios_took = std::chrono::steady_clock::now() - scenarios_start;
+
+    LiveStats live;
+    if (feed)
+        live = follow(engine, topo, opts, t, *feed, reference.get(), out);
+
+    if (!opts.save_snapshot_path.empty()) {
+        out.flush();
+        engine.save_snapshot(opts.save_snapshot_path, t);
+    }
+
+    if (opts.stop_counting) {
+        const dv::EngineStats& stats = engine.stats();
+        out.flush();
+        std::cerr << "count to infinity: stopped " << stats.counts_stopped << " time(s), skipping up to "
+                  << stats.rounds_skipped << " round(s); " << stats.looping_routes
+                  << " route(s) were on next-hop loops\n";
+    }
+    if (opts.stats) {
+        const dv::ArenaStats arenas = engine.arena_stats();
+        out.flush();
+        std::cerr << "arena peak bytes: graph " << arenas.graph_peak
+                  << ", per-round " << arenas.round_peak
+                  << ", per-update " << arenas.scratch_peak << '\n';
+        const std::uint64_t dense = std::uint64_t{topo.names.size()} * topo.names.size();
+        if (engine.stored_entries() < dense) {
+            std::cerr << "row windows: " << engine.stored_entries() << " entries stored per table, "
+                      << 100.0 * engine.stored_entries() / dense << "% of dense\n";
+        }
+        if (opts.compact) {
+            std::cerr << "tables: "
+                      << (engine.compact() ? "16-bit"
+                          : engine.stats().widened ? "widened to 32-bit after a cost overflowed"
+                                                   : "32-bit")
+                      << '\n';
+        }
+        if (!scenarios.empty()) {
+            std::cerr << "scenarios: " << scenarios.size() << " in "
+                      << std::chrono::duration<double>(scenarios_took).count() << " s\n";
+        }
+        if (feed) {
+            using Micros = std::chrono::duration<double, std::micro>;
+            const double mean = live.batches ? Micros(live.total).count() / live.batches : 0.0;
+            std::cerr << "live: " << live.updates << " update(s) in " << live.batches
+                      << " batch(es), " << mean << " us mean and " << Micros(live.longest).count()
+                      << " us max per batch\n";
+        }
+    }
+}
+
+// Partitioned run: the routers are split across worker processes, each
+// running an engine over its share, and this process prints their merged
+// output, which matches run()'s.
+template <typename Policy>
+void run_partitioned(const dv::Topology& topo, const dv::Options& opts)
+{
+    const dv::NodeId n = topo.names.size();
+    dv::Arena scratch;
+    dv::Graph net(n);
+    for (const auto& link : topo.links)
+        net.set_link(link.a, link.b, link.cost);
+    net.build(scratch);
+    const std::vector<std::uint32_t> part = dv::partition_routers(net, opts.partitions, opts.partition_scheme);
+    const std::vector<dv::NodeId> query = query_routers(topo.names, opts.query);
+    if (opts.stats) {
+        std::vector<dv::NodeId> sizes(opts.partitions);
+        for (const std::uint32_t p : part)
+            ++sizes[p];
+        std::cerr << "partitions: " << opts.partitions << " holding";
+        for (const dv::NodeId size : sizes)
+            std::cerr << ' ' << size;
+        std::cerr << " routers; " << dv::cut_links(net, part) << " of " << topo.links.size()
+                  << " links cut\n";
+    }
+
+    dv::Coordinator coordinator = dv::spawn_workers(n, part, opts.partitions, [&](dv::WorkerLinks& links) {
+        dv::EngineConfig config;
+        config.incremental = !opts.full_recompute;
+        config.threads = opts.threads;
+        config.tables = opts.tables;
+        config.infinity = opts.infinity;
+        config.compact = opts.compact;
+        config.table_dir = opts.table_dir;
+        config.query = query;
+        config.cluster = &links;
+        dv::Engine<Policy> engine(topo, config);
+        dv::OutputWriter& out = links.output();
+        const int t = engine.converge(0, out);
+        engine.print_routing_tables(out);
+        out.flush();
+        if (engine.apply_updates(topo.updates)) {
+            engine.converge(t + 1, out);
+            engine.print_routing_tables(out);
+        }
+        return 0;
+    });
+
+    if (!query.empty())
+        coordinator.show_only(query);
+    dv::OutputWriter out(STDOUT_FILENO);
+    const int t = coordinator.converge(0, opts.tables, out);
+    coordinator.print_routing_tables(out);
+    if (!topo.updates.empty()) {
+        coordinator.converge(t + 1, opts.tables, out);
+        coordinator.print_routing_tables(out);
+    }
+    out.flush();
+    coordinator.wait();
+}
+
+// --simulate: converges in the discrete-event simulator instead, printing
+// the routing tables and, on stderr, each convergence's simulated time
+// and work.
+template <typename Policy>
+void run_simulated(const dv::Topology& topo, const dv::Options& opts)
+{
+    dv::SimConfig config;
+    config.infinity = opts.infinity;
+    config.query = query_routers(topo.names, opts.query);
+    dv::EventSim<Policy> sim(topo, config);
+    dv::OutputWriter out(STDOUT_FILENO);
+    std::unique_ptr<dv::LinkState> reference;
+    if (opts.verify)
+        reference = std::make_unique<dv::LinkState>(topo, opts.threads);
+
+    auto report = [&](const char* what, const dv::SimReport& r) {
+        const std::uint64_t took = r.end - r.start;
+        out.flush();
+        std::cerr << "simulate: " << what << " in " << took / 1000000 << '.' << std::setw(6) << std::setfill('0')
+                  << took % 1000000 << std::setfill(' ') << " s simulated; " << r.advertisements
+                  << " advertisements, " << r.relaxations << " relaxations, " << r.route_changes
+                  << " route changes, at most " << r.peak_in_flight << " in flight\n";
+    };
+    report("converged", sim.converge());
+    sim.print_routing_tables(out);
+    if (reference)
+        verify(*reference, sim.rows(), topo, opts.infinity, out);
+    if (sim.apply_updates(topo.updates)) {
+        report("update converged", sim.converge());
+        sim.print_routing_tables(out);
+        if (reference) {
+            reference->apply_updates(topo.updates);
+            verify(*reference, sim.rows(), topo, opts.infinity, out);
+        }
+    }
+    out.flush();
+    if (opts.stats)
+        std::cerr << "calendar queue: " << sim.bucket_count() << " buckets of " << sim.bucket_width() << " us\n";
+}
+
+// Renumbers topo's routers in the --reorder order; --stats reports the
+// largest ID gap across a link before and after.
+void reorder(dv::Topology& topo, const dv::Options& opts)
+{
+    dv::Arena scratch;
+    dv::Graph net(topo.names.size());
+    for (const auto& link : topo.links)
+        net.set_link(link.a, link.b, link.cost);
+    net.build(scratch);
+    const dv::NodeId before = dv::bandwidth(topo);
+    dv::renumber(topo, dv::order_routers(net, opts.reorder));
+    if (opts.stats)
+        std::cerr << "reorder: largest ID gap across a link " << before << " -> " << dv::bandwidth(topo) << '\n';
+}
+
+// Takes the policy and bound a snapshot was converged under, unless the
+// command line asked for others, which cannot continue from it.
+void adopt_snapshot_settings(const dv::SnapshotInfo& info, dv::Options& opts)
+{
+    if (opts.policy_given && opts.policy != info.policy) {
+        throw std::runtime_error(std::string("snapshot was converged with --policy ")
+                                 + dv::policy_name(info.policy));
+    }
+    if (opts.infinity_given && opts.infinity != info.infinity)
+        throw std::runtime_error("snapshot was converged with --infinity " + std::to_string(info.infinity));
+    opts.policy = info.policy;
+    opts.infinity = info.infinity;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    dv::Options opts;
+    try {
+        opts = dv::parse_options(argc, argv);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "DistanceVector: " << e.what() << '\n';
+        dv::print_usage(std::cerr);
+        return 2;
+    }
+    if (opts.help) {
+        dv::print_usage(std::cout);
+        return 0;
+    }
+
+    if (!dv::instrument::kEnabled && (!opts.profile_path.empty() || !opts.trace_path.empty())) {
+        std::cerr << "DistanceVector: --profile and --trace need a build with -DDV_INSTRUMENT=ON\n";
+        return 2;
+    }
+    if (!dv::select_relax_kernel(opts.kernel)) {
+        std::cerr << "DistanceVector: kernel '" << opts.kernel << "' is not available on this CPU\n";
+        return 2;
+    }
+
+    try {
+        // In live mode stdin is the feed. Without an input file it also
+        // carries the topology, and everything after UPDATE is the feed;
+        // after a snapshot there is no topology to read.
+        dv::Topology topo;
+        dv::Snapshot snapshot;
+        std::unique_ptr<dv::LineStream> feed;
+        if (opts.live)
+            feed = std::make_unique<dv::LineStream>(STDIN_FILENO);
+        if (!opts.load_snapshot_path.empty()) {
+            snapshot = dv::Snapshot::open(opts.load_snapshot_path);
+            adopt_snapshot_settings(snapshot.info(), opts);
+            topo = snapshot.topology();
+        }
+        const bool read_input = !feed || !opts.input_path.empty();
+        if (feed && !read_input && opts.load_snapshot_path.empty()) {
+            std::string head;
+            feed->read_until("UPDATE", head);
+            topo = dv::parse_input(head);
+        } else if (read_input) {
+            dv::InputSource input = opts.input_path.empty()
+                ? dv::InputSource::from_fd(STDIN_FILENO)
+                : dv::InputSource::open(opts.input_path.c_str());
+            if (opts.load_snapshot_path.empty())
+                topo = dv::parse_input(input.text());
+            else
+                topo.updates = dv::parse_updates(input.text(), topo.names);
+        }
+
+        if (opts.reorder != dv::NodeOrder::input)
+            reorder(topo, opts);
+
+        switch (opts.policy) {
+        case dv::PolicyKind::plain:
+            if (opts.simulate)
+                run_simulated<dv::Plain>(topo, opts);
+            else if (opts.partitions > 1)
+                run_partitioned<dv::Plain>(topo, opts);
+            else
+                run<dv::Plain>(topo, opts, feed.get(), std::move(snapshot));
+            break;
+        case dv::PolicyKind::split_horizon:
+            if (opts.simulate)
+                run_simulated<dv::SplitHorizon>(topo, opts);
+            else if (opts.partitions > 1)
+                run_partitioned<dv::SplitHorizon>(topo, opts);
+            else
+                run<dv::SplitHorizon>(topo, opts, feed.get(), std::move(snapshot));
+            break;
+        case dv::PolicyKind::poisoned_reverse:
+            if (opts.simulate)
+                run_simulated<dv::PoisonedReverse>(topo, opts);
+            else if (opts.partitions > 1)
+                run_partitioned<dv::PoisonedReverse>(topo, opts);
+            else
+                run<dv::PoisonedReverse>(topo, opts, feed.get(), std::move(snapshot));
+            break;
+        }
+        if (!opts.profile_path.empty())
+            dv::instrument::write_summary(opts.profile_path);
+        if (!opts.trace_path.empty())
+            dv::instrument::write_trace(opts.trace_path);
+    } catch (const std::exception& e) {
+        std::cerr << "DistanceVector: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,443 @@
+#include "minplus.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DV_HAVE_X86 1
+#endif
+
+namespace dv {
+
+void relax_scalar(Cost* dst, NodeId* via, const Cost* src, Cost cost, NodeId hop, std::size_t n)
+{
+    for (std::size_t y = 0; y < n; ++y) {
+        const Cost d = cost + src[y];
+        if (d < dst[y]) {
+            dst[y] = d;
+            via[y] = hop;
+        }
+    }
+}
+
+void relax_poisoned_scalar(Cost* dst, NodeId* via, const Cost* src, const NodeId* src_via, Cost cost,
+                           NodeId hop, NodeId self, std::size_t n)
+{
+    for (std::size_t y = 0; y < n; ++y) {
+        const Cost d = cost + src[y];
+        if (d < dst[y] && src_via[y] != self) {
+            dst[y] = d;
+            via[y] = hop;
+        }
+    }
+}
+
+void diff_scalar(const Cost* dist, const NodeId* via, const Cost* old_dist, const NodeId* old_via,
+                 std::uint64_t* changed, std::size_t n)
+{
+    for (std::size_t w = 0; w * 64 < n; ++w) {
+        std::uint64_t bits = 0;
+        for (std::size_t j = 0, y = w * 64; j < 64 && y < n; ++j, ++y)
+            bits |= std::uint64_t{dist[y] != old_dist[y] || via[y] != old_via[y]} << j;
+        changed[w] = bits;
+    }
+}
+
+namespace {
+
+// A link cost as a compact addend; anything larger saturates every sum.
+CompactCost compact_addend(Cost cost)
+{
+    return static_cast<CompactCost>(std::min<Cost>(cost, kCompactInfinity));
+}
+
+} // namespace
+
+bool relax_compact_scalar(CompactCost* dst, NodeId* via, const CompactCost* src, Cost cost, NodeId hop,
+                          std::size_t n)
+{
+    const std::uint32_t c = compact_addend(cost);
+    bool saturated = false;
+    for (std::size_t y = 0; y < n; ++y) {
+        const auto d = static_cast<CompactCost>(std::min<std::uint32_t>(src[y] + c, kCompactInfinity));
+        if (d < dst[y]) {
+            dst[y] = d;
+            via[y] = hop;
+        }
+        saturated |= d == kCompactInfinity && src[y] != kCompactInfinity;
+    }
+    return saturated;
+}
+
+bool relax_compact_poisoned_scalar(CompactCost* dst, NodeId* via, const CompactCost* src, const NodeId* src_via,
+                                   Cost cost, NodeId hop, NodeId self, std::size_t n)
+{
+    const std::uint32_t c = compact_addend(cost);
+    bool saturated = false;
+    for (std::size_t y = 0; y < n; ++y) {
+        if (src_via[y] == self)
+            continue;
+        const auto d = static_cast<CompactCost>(std::min<std::uint32_t>(src[y] + c, kCompactInfinity));
+        if (d < dst[y]) {
+            dst[y] = d;
+            via[y] = hop;
+        }
+        saturated |= d == kCompactInfinity && src[y] != kCompactInfinity;
+    }
+    return saturated;
+}
+
+void diff_compact_scalar(const CompactCost* dist, const NodeId* via, const CompactCost* old_dist,
+                         const NodeId* old_via, std::uint64_t* changed, std::size_t n)
+{
+    for (std::size_t w = 0; w * 64 < n; ++w) {
+        std::uint64_t bits = 0;
+        for (std::size_t j = 0, y = w * 64; j < 64 && y < n; ++j, ++y)
+            bits |= std::uint64_t{dist[y] != old_dist[y] || via[y] != old_via[y]} << j;
+        changed[w] = bits;
+    }
+}
+
+#ifdef DV_HAVE_X86
+
+namespace {
+
+__attribute__((target("avx2"))) void relax_avx2(Cost* dst, NodeId* via, const Cost* src, Cost cost,
+                                                NodeId hop, std::size_t n)
+{
+    const __m256i c = _mm256_set1_epi32(cost);
+    const __m256i h = _mm256_set1_epi32(static_cast<int>(hop));
+    for (std::size_t y = 0; y < n; y += 8) {
+        auto* d_ptr = reinterpret_cast<__m256i*>(dst + y);
+        auto* v_ptr = reinterpret_cast<__m256i*>(via + y);
+        const __m256i cand = _mm256_add_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(src + y)), c);
+        const __m256i d = _mm256_load_si256(d_ptr);
+        const __m256i better = _mm256_cmpgt_epi32(d, cand);
+        _mm256_store_si256(d_ptr, _mm256_blendv_epi8(d, cand, better));
+        _mm256_store_si256(v_ptr, _mm256_blendv_epi8(_mm256_load_si256(v_ptr), h, better));
+    }
+}
+
+__attribute__((target("avx512f"))) void relax_avx512(Cost* dst, NodeId* via, const Cost* src, Cost cost,
+                                                     NodeId hop, std::size_t n)
+{
+    const __m512i c = _mm512_set1_epi32(cost);
+    const __m512i h = _mm512_set1_epi32(static_cast<int>(hop));
+    for (std::size_t y = 0; y < n; y += 16) {
+        const __m512i cand = _mm512_add_epi32(_mm512_load_si512(src + y), c);
+        const __m512i d = _mm512_load_si512(dst + y);
+        const __mmask16 better = _mm512_cmpgt_epi32_mask(d, cand);
+        _mm512_mask_store_epi32(dst + y, better, cand);
+        _mm512_mask_store_epi32(via + y, better, h);
+    }
+}
+
+__attribute__((target("avx2"))) void relax_poisoned_avx2(Cost* dst, NodeId* via, const Cost* src,
+                                                         const NodeId* src_via, Cost cost, NodeId hop,
+                                                         NodeId self, std::size_t n)
+{
+    const __m256i c = _mm256_set1_epi32(cost);
+    const __m256i h = _mm256_set1_epi32(static_cast<int>(hop));
+    const __m256i me = _mm256_set1_epi32(static_cast<int>(self));
+    for (std::size_t y = 0; y < n; y += 8) {
+        auto* d_ptr = reinterpret_cast<__m256i*>(dst + y);
+        auto* v_ptr = reinterpret_cast<__m256i*>(via + y);
+        const __m256i cand = _mm256_add_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(src + y)), c);
+        const __m256i poisoned
+            = _mm256_cmpeq_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(src_via + y)), me);
+        const __m256i d = _mm256_load_si256(d_ptr);
+        const __m256i better = _mm256_andnot_si256(poisoned, _mm256_cmpgt_epi32(d, cand));
+        _mm256_store_si256(d_ptr, _mm256_blendv_epi8(d, cand, better));
+        _mm256_store_si256(v_ptr, _mm256_blendv_epi8(_mm256_load_si256(v_ptr), h, better));
+    }
+}
+
+__attribute__((target("avx512f"))) void relax_poisoned_avx512(Cost* dst, NodeId* via, const Cost* src,
+                                                              const NodeId* src_via, Cost cost,
+                                                              NodeId hop, NodeId self, std::size_t n)
+{
+    const __m512i c = _mm512_set1_epi32(cost);
+    const __m512i h = _mm512_set1_epi32(static_cast<int>(hop));
+    const __m512i me = _mm512_set1_epi32(static_cast<int>(self));
+    for (std::size_t y = 0; y < n; y += 16) {
+        const __m512i cand = _mm512_add_epi32(_mm512_load_si512(src + y), c);
+        const __mmask16 open = _mm512_cmpneq_epi32_mask(_mm512_load_si512(src_via + y), me);
+        const __mmask16 better = _mm512_mask_cmpgt_epi32_mask(open, _mm512_load_si512(dst + y), cand);
+        _mm512_mask_store_epi32(dst + y, better, cand);
+        _mm512_mask_store_epi32(via + y, better, h);
+    }
+}
+
+__attribute__((target("avx2"))) void diff_avx2(const Cost* dist, const NodeId* via, const Cost* old_dist,
+                                               const NodeId* old_via, std::uint64_t* changed, std::size_t n)
+{
+    for (std::size_t w = 0; w * 64 < n; ++w) {
+        std::uint64_t bits = 0;
+        for (std::size_t j = 0, y = w * 64; j < 64 && y < n; j += 8, y += 8) {
+            const __m256i same_cost
+                = _mm256_cmpeq_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(dist + y)),
+                                     _mm256_load_si256(reinterpret_cast<const __m256i*>(old_dist + y)));
+            const __m256i same_hop
+                = _mm256_cmpeq_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(via + y)),
+                                     _mm256_load_si256(reinterpret_cast<const __m256i*>(old_via + y)));
+            const __m256i same = _mm256_and_si256(same_cost, same_hop);
+            const auto lanes = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(same)));
+            bits |= std::uint64_t{~lanes & 0xffu} << j;
+        }
+        changed[w] = bits;
+    }
+}
+
+__attribute__((target("avx512f"))) void diff_avx512(const Cost* dist, const NodeId* via, const Cost* old_dist,
+                                                    const NodeId* old_via, std::uint64_t* changed, std::size_t n)
+{
+    for (std::size_t w = 0; w * 64 < n; ++w) {
+        std::uint64_t bits = 0;
+        for (std::size_t j = 0, y = w * 64; j < 64 && y < n; j += 16, y += 16) {
+            const __mmask16 cost
+                = _mm512_cmpneq_epi32_mask(_mm512_load_si512(dist + y), _mm512_load_si512(old_dist + y));
+            const __mmask16 hop
+                = _mm512_cmpneq_epi32_mask(_mm512_load_si512(via + y), _mm512_load_si512(old_via + y));
+            bits |= std::uint64_t{static_cast<std::uint16_t>(cost | hop)} << j;
+        }
+        changed[w] = bits;
+    }
+}
+
+// Compact rows hold 16 entries per AVX2 register; the matching next
+// hops take two, so lane masks are widened to 32 bits for them.
+__attribute__((target("avx2"))) void select_hops_avx2(NodeId* via, __m256i hop, __m256i better)
+{
+    auto* lo = reinterpret_cast<__m256i*>(via);
+    auto* hi = lo + 1;
+    const __m256i lo_mask = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(better));
+    const __m256i hi_mask = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(better, 1));
+    _mm256_store_si256(lo, _mm256_blendv_epi8(_mm256_load_si256(lo), hop, lo_mask));
+    _mm256_store_si256(hi, _mm256_blendv_epi8(_mm256_load_si256(hi), hop, hi_mask));
+}
+
+__attribute__((target("avx2"))) bool relax_compact_avx2(CompactCost* dst, NodeId* via, const CompactCost* src,
+                                                        Cost cost, NodeId hop, std::size_t n)
+{
+    const __m256i c = _mm256_set1_epi16(static_cast<short>(compact_addend(cost)));
+    const __m256i h = _mm256_set1_epi32(static_cast<int>(hop));
+    const __m256i inf = _mm256_set1_epi16(-1);
+    __m256i saturated = _mm256_setzero_si256();
+    for (std::size_t y = 0; y < n; y += 16) {
+        auto* d_ptr = reinterpret_cast<__m256i*>(dst + y);
+        const __m256i s = _mm256_load_si256(reinterpret_cast<const __m256i*>(src + y));
+        const __m256i cand = _mm256_adds_epu16(s, c);
+        const __m256i d = _mm256_load_si256(d_ptr);
+        const __m256i best = _mm256_min_epu16(d, cand);
+        const __m256i better = _mm256_xor_si256(_mm256_cmpeq_epi16(best, d), inf);
+        _mm256_store_si256(d_ptr, best);
+        select_hops_avx2(via + y, h, better);
+        saturated = _mm256_or_si256(
+            saturated, _mm256_andnot_si256(_mm256_cmpeq_epi16(s, inf), _mm256_cmpeq_epi16(cand, inf)));
+    }
+    return !_mm256_testz_si256(saturated, saturated);
+}
+
+__attribute__((target("avx2"))) bool relax_compact_poisoned_avx2(CompactCost* dst, NodeId* via,
+                                                                 const CompactCost* src, const NodeId* src_via,
+                                                                 Cost cost, NodeId hop, NodeId self,
+                                                                 std::size_t n)
+{
+    const __m256i c = _mm256_set1_epi16(static_cast<short>(compact_addend(cost)));
+    const __m256i h = _mm256_set1_epi32(static_cast<int>(hop));
+    const __m256i me = _mm256_set1_epi32(static_cast<int>(self));
+    const __m256i inf = _mm256_set1_epi16(-1);
+    __m256i saturated = _mm256_setzero_si256();
+    for (std::size_t y = 0; y < n; y += 16) {
+        auto* d_ptr = reinterpret_cast<__m256i*>(dst + y);
+        const auto* v_ptr = reinterpret_cast<const __m256i*>(src_via + y);
+        // packs works per 128-bit half; the permute restores lane order.
+        const __m256i poisoned = _mm256_permute4x64_epi64(
+            _mm256_packs_epi32(_mm256_cmpeq_epi32(_mm256_load_si256(v_ptr), me),
+                               _mm256_cmpeq_epi32(_mm256_load_si256(v_ptr + 1), me)),
+            0xd8);
+        const __m256i s = _mm256_load_si256(reinterpret_cast<const __m256i*>(src + y));
+        const __m256i cand = _mm256_or_si256(_mm256_adds_epu16(s, c), poisoned);
+        const __m256i d = _mm256_load_si256(d_ptr);
+        const __m256i best = _mm256_min_epu16(d, cand);
+        const __m256i better = _mm256_xor_si256(_mm256_cmpeq_epi16(best, d), inf);
+        _mm256_store_si256(d_ptr, best);
+        select_hops_avx2(via + y, h, better);
+        const __m256i exempt = _mm256_or_si256(_mm256_cmpeq_epi16(s, inf), poisoned);
+        saturated = _mm256_or_si256(saturated, _mm256_andnot_si256(exempt, _mm256_cmpeq_epi16(cand, inf)));
+    }
+    return !_mm256_testz_si256(saturated, saturated);
+}
+
+__attribute__((target("avx2"))) void diff_compact_avx2(const CompactCost* dist, const NodeId* via,
+                                                       const CompactCost* old_dist, const NodeId* old_via,
+                                                       std::uint64_t* changed, std::size_t n)
+{
+    for (std::size_t w = 0; w * 64 < n; ++w) {
+        std::uint64_t bits = 0;
+        for (std::size_t j = 0, y = w * 64; j < 64 && y < n; j += 8, y += 8) {
+            const __m256i same_cost = _mm256_cmpeq_epi32(
+                _mm256_cvtepu16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(dist + y))),
+                _mm256_cvtepu16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(old_dist + y))));
+            const __m256i same_hop
+                = _mm256_cmpeq_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(via + y)),
+                                     _mm256_load_si256(reinterpret_cast<const __m256i*>(old_via + y)));
+            const __m256i same = _mm256_and_si256(same_cost, same_hop);
+            const auto lanes = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(same)));
+            bits |= std::uint64_t{~lanes & 0xffu} << j;
+        }
+        changed[w] = bits;
+    }
+}
+
+__attribute__((target("avx512f,avx512bw"))) bool relax_compact_avx512(CompactCost* dst, NodeId* via,
+                                                                      const CompactCost* src, Cost cost,
+                                                                      NodeId hop, std::size_t n)
+{
+    const __m512i c = _mm512_set1_epi16(static_cast<short>(compact_addend(cost)));
+    const __m512i h = _mm512_set1_epi32(static_cast<int>(hop));
+    const __m512i inf = _mm512_set1_epi16(-1);
+    __mmask32 saturated = 0;
+    for (std::size_t y = 0; y < n; y += 32) {
+        const __m512i s = _mm512_load_si512(src + y);
+        const __m512i cand = _mm512_adds_epu16(s, c);
+        const __mmask32 better = _mm512_cmplt_epu16_mask(cand, _mm512_load_si512(dst + y));
+        _mm512_mask_storeu_epi16(dst + y, better, cand);
+        _mm512_mask_store_epi32(via + y, static_cast<__mmask16>(better), h);
+        _mm512_mask_store_epi32(via + y + 16, static_cast<__mmask16>(better >> 16), h);
+        saturated |= _mm512_mask_cmpeq_epu16_mask(_mm512_cmpneq_epu16_mask(s, inf), cand, inf);
+    }
+    return saturated != 0;
+}
+
+__attribute__((target("avx512f,avx512bw"))) bool relax_compact_poisoned_avx512(
+    CompactCost* dst, NodeId* via, const CompactCost* src, const NodeId* src_via, Cost cost, NodeId hop,
+    NodeId self, std::size_t n)
+{
+    const __m512i c = _mm512_set1_epi16(static_cast<short>(compact_addend(cost)));
+    const __m512i h = _mm512_set1_epi32(static_cast<int>(hop));
+    const __m512i me = _mm512_set1_epi32(static_cast<int>(self));
+    const __m512i inf = _mm512_set1_epi16(-1);
+    __mmask32 saturated = 0;
+    for (std::size_t y = 0; y < n; y += 32) {
+        const __mmask32 open = _mm512_cmpneq_epi32_mask(_mm512_load_si512(src_via + y), me)
+            | static_cast<__mmask32>(_mm512_cmpneq_epi32_mask(_mm512_load_si512(src_via + y + 16), me)) << 16;
+        const __m512i s = _mm512_load_si512(src + y);
+        const __m512i cand = _mm512_adds_epu16(s, c);
+        const __mmask32 better = _mm512_mask_cmplt_epu16_mask(open, cand, _mm512_load_si512(dst + y));
+        _mm512_mask_storeu_epi16(dst + y, better, cand);
+        _mm512_mask_store_epi32(via + y, static_cast<__mmask16>(better), h);
+        _mm512_mask_store_epi32(via + y + 16, static_cast<__mmask16>(better >> 16), h);
+        saturated |= _mm512_mask_cmpeq_epu16_mask(open & _mm512_cmpneq_epu16_mask(s, inf), cand, inf);
+    }
+    return saturated != 0;
+}
+
+__attribute__((target("avx512f,avx512bw"))) void diff_compact_avx512(const CompactCost* dist, const NodeId* via,
+                                                                     const CompactCost* old_dist,
+                                                                     const NodeId* old_via, std::uint64_t* changed,
+                                                                     std::size_t n)
+{
+    for (std::size_t w = 0; w * 64 < n; ++w) {
+        std::uint64_t bits = 0;
+        for (std::size_t j = 0, y = w * 64; j < 64 && y < n; j += 32, y += 32) {
+            const __mmask32 cost
+                = _mm512_cmpneq_epu16_mask(_mm512_load_si512(dist + y), _mm512_load_si512(old_dist + y));
+            const __mmask32 hop = _mm512_cmpneq_epi32_mask(_mm512_load_si512(via + y), _mm512_load_si512(old_via + y))
+                | static_cast<__mmask32>(
+                      _mm512_cmpneq_epi32_mask(_mm512_load_si512(via + y + 16), _mm512_load_si512(old_via + y + 16)))
+                    << 16;
+            bits |= std::uint64_t{static_cast<std::uint32_t>(cost | hop)} << j;
+        }
+        changed[w] = bits;
+    }
+}
+
+} // namespace
+
+#endif
+
+namespace {
+
+struct Kernel {
+    RelaxKernels fns;
+    bool (*supported)();
+};
+
+bool always()
+{
+    return true;
+}
+
+#ifdef DV_HAVE_X86
+bool has_avx512()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+
+bool has_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+// Widest first.
+const Kernel kKernels[] = {
+#ifdef DV_HAVE_X86
+    {{"avx512", relax_avx512, relax_poisoned_avx512, diff_avx512, relax_compact_avx512,
+      relax_compact_poisoned_avx512, diff_compact_avx512},
+     has_avx512},
+    {{"avx2", relax_avx2, relax_poisoned_avx2, diff_avx2, relax_compact_avx2, relax_compact_poisoned_avx2,
+      diff_compact_avx2},
+     has_avx2},
+#endif
+    {{"scalar", relax_scalar, relax_poisoned_scalar, diff_scalar, relax_compact_scalar,
+      relax_compact_poisoned_scalar, diff_compact_scalar},
+     always},
+};
+
+const Kernel* best_kernel()
+{
+    for (const Kernel& k : kKernels) {
+        if (k.supported())
+            return &k;
+    }
+    return nullptr;
+}
+
+const Kernel*& dispatch_slot()
+{
+    static const Kernel* selected = best_kernel();
+    return selected;
+}
+
+const Kernel& dispatch()
+{
+    return *dispatch_slot();
+}
+
+} // namespace
+
+const RelaxKernels& relax_kernels()
+{
+    return dispatch().fns;
+}
+
+bool select_relax_kernel(std::string_view name)
+{
+    if (name == "auto") {
+        dispatch_slot() = best_kernel();
+        return true;
+    }
+    for (const Kernel& k : kKernels) {
+        if (name == k.fns.name && k.supported()) {
+            dispatch_slot() = &k;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace dv
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "cost.hpp"
+#include "names.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace dv {
+
+// The distance-vector relaxation over one neighbour's row:
+//
+//     for each y: if cost + src[y] < dst[y] then dst[y] = cost + src[y], via[y] = hop
+//
+// n must be a multiple of RouteMatrix::kLane and all rows 64-byte aligned.
+// Strict comparison keeps the first neighbour relaxed on ties.
+using RelaxFn = void (*)(Cost* dst, NodeId* via, const Cost* src, Cost cost, NodeId hop,
+                         std::size_t n);
+
+// The same with the neighbour's advertisement poisoned: entries it routes
+// through self (src_via[y] == self) count as unreachable.
+using RelaxPoisonedFn = void (*)(Cost* dst, NodeId* via, const Cost* src, const NodeId* src_via,
+                                 Cost cost, NodeId hop, NodeId self, std::size_t n);
+
+// Sets bit y of changed (64 per word, ceil(n / 64) words) where dist/via
+// and old_dist/old_via differ, clearing the others.
+using DiffFn = void (*)(const Cost* dist, const NodeId* via, const Cost* old_dist, const NodeId* old_via,
+                        std::uint64_t* changed, std::size_t n);
+
+// The same three over compact entries (CompactRouteMatrix, n a multiple
+// of its kLane). Sums saturate at kCompactInfinity; the relaxations
+// return true if a finite entry's sum did, which means the true cost
+// does not fit.
+using CompactRelaxFn = bool (*)(CompactCost* dst, NodeId* via, const CompactCost* src, Cost cost, NodeId hop,
+                                std::size_t n);
+using CompactRelaxPoisonedFn = bool (*)(CompactCost* dst, NodeId* via, const CompactCost* src,
+                                        const NodeId* src_via, Cost cost, NodeId hop, NodeId self,
+                                        std::size_t n);
+using CompactDiffFn = void (*)(const CompactCost* dist, const NodeId* via, const CompactCost* old_dist,
+                               const NodeId* old_via, std::uint64_t* changed, std::size_t n);
+
+struct RelaxKernels {
+    const char* name;
+    RelaxFn plain;
+    RelaxPoisonedFn poisoned;
+    DiffFn diff;
+    CompactRelaxFn compact_plain;
+    CompactRelaxPoisonedFn compact_poisoned;
+    CompactDiffFn compact_diff;
+};
+
+// The widest kernels this CPU supports (AVX-512 F and BW, AVX2, else scalar),
+// chosen once on first use.
+const RelaxKernels& relax_kernels();
+
+// Forces a kernel by name ("scalar", "avx2", "avx512" or "auto"); returns
+// false if it is unknown or unsupported on this CPU.
+bool select_relax_kernel(std::string_view name);
+
+void relax_scalar(Cost* dst, NodeId* via, const Cost* src, Cost cost, NodeId hop, std::size_t n);
+void relax_poisoned_scalar(Cost* dst, NodeId* via, const Cost* src, const NodeId* src_via, Cost cost,
+                           NodeId hop, NodeId self, std::size_t n);
+void diff_scalar(const Cost* dist, const NodeId* via, const Cost* old_dist, const NodeId* old_via,
+                 std::uint64_t* changed, std::size_t n);
+bool relax_compact_scalar(CompactCost* dst, NodeId* via, const CompactCost* src, Cost cost, NodeId hop,
+                          std::size_t n);
+bool relax_compact_poisoned_scalar(CompactCost* dst, NodeId* via, const CompactCost* src, const NodeId* src_via,
+                                   Cost cost, NodeId hop, NodeId self, std::size_t n);
+void diff_compact_scalar(const CompactCost* dist, const NodeId* via, const CompactCost* old_dist,
+                         const NodeId* old_via, std::uint64_t* changed, std::size_t n);
+
+} // namespace dv
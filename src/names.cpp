@@ -0,0 +1,84 @@
+#include "names.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace dv {
+
+// Eight bytes at a time, multiplied in and finished with the murmur3 mix,
+// so the low bits that pick a slot and the high bits kept as a tag both
+// depend on every byte.
+std::uint64_t NameTable::hash(std::string_view name)
+{
+    constexpr std::uint64_t kMul = 0x9e3779b97f4a7c15;
+    std::uint64_t h = name.size() * kMul;
+    const char* p = name.data();
+    std::size_t left = name.size();
+    for (; left >= 8; p += 8, left -= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p, 8);
+        h = (h ^ word) * kMul;
+        h ^= h >> 29;
+    }
+    if (left > 0) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, p, left);
+        h = (h ^ word) * kMul;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccd;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53;
+    h ^= h >> 33;
+    return h;
+}
+
+NodeId NameTable::add(std::string_view name)
+{
+    if (name.size() > UINT32_MAX - text_.size())
+        throw std::runtime_error("router names exceed 4 GiB");
+    const NodeId id = size();
+    text_.append(name);
+    ends_.push_back(static_cast<std::uint32_t>(text_.size()));
+    return id;
+}
+
+void NameTable::build_index()
+{
+    std::size_t capacity = 16;
+    while (capacity < 2 * std::size_t{size()})
+        capacity *= 2;
+    slots_.assign(capacity, kEmpty);
+    const std::size_t mask = capacity - 1;
+    for (NodeId x = 0; x < size(); ++x) {
+        const std::string_view key = name(x);
+        const std::uint64_t h = hash(key);
+        const std::uint64_t tag = h & ~std::uint64_t{UINT32_MAX};
+        std::size_t i = h & mask;
+        for (; slots_[i] != kEmpty; i = (i + 1) & mask) {
+            if ((slots_[i] & ~std::uint64_t{UINT32_MAX}) == tag
+                && name(static_cast<NodeId>(slots_[i])) == key)
+                throw std::runtime_error("duplicate router '" + std::string(key) + "'");
+        }
+        slots_[i] = tag | x;
+    }
+}
+
+NodeId NameTable::lookup(std::string_view name) const
+{
+    if (!slots_.empty()) {
+        const std::uint64_t h = hash(name);
+        const std::uint64_t tag = h & ~std::uint64_t{UINT32_MAX};
+        const std::size_t mask = slots_.size() - 1;
+        for (std::size_t i = h & mask; slots_[i] != kEmpty; i = (i + 1) & mask) {
+            if ((slots_[i] & ~std::uint64_t{UINT32_MAX}) == tag) {
+                const auto id = static_cast<NodeId>(slots_[i]);
+                if (this->name(id) == name)
+                    return id;
+            }
+        }
+    }
+    throw std::runtime_error("unknown router '" + std::string(name) + "'");
+}
+
+} // namespace dv
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dv {
+
+using NodeId = std::uint32_t;
+constexpr NodeId kNoNode = static_cast<NodeId>(-1);
+
+// Interns router names into dense IDs in declaration order. The names are
+// appended back to back to one string, so name() is a slice of it. Once
+// they are all declared, build_index() hashes them into an open-addressing
+// table, and lookups take a string_view into the input buffer and do not
+// allocate.
+class NameTable {
+public:
+    NameTable() = default;
+    NameTable(NameTable&&) = default;
+    NameTable& operator=(NameTable&&) = default;
+    NameTable(const NameTable&) = delete;
+    NameTable& operator=(const NameTable&) = delete;
+
+    NodeId add(std::string_view name);
+
+    // Indexes every name added so far; call it after the last add() and
+    // before lookup(). Throws std::runtime_error on a name declared twice.
+    void build_index();
+
+    // Throws std::runtime_error for undeclared names.
+    NodeId lookup(std::string_view name) const;
+
+    std::string_view name(NodeId id) const
+    {
+        return std::string_view(text_.data() + ends_[id], ends_[id + 1] - ends_[id]);
+    }
+    NodeId size() const { return static_cast<NodeId>(ends_.size() - 1); }
+
+private:
+    static std::uint64_t hash(std::string_view name);
+
+    std::string text_;
+    std::vector<std::uint32_t> ends_{0}; // name x is text_[ends_[x], ends_[x + 1])
+    // Power-of-two table at most half full. A slot holds the name's hash in
+    // its high half and the ID in its low half, or kEmpty.
+    static constexpr std::uint64_t kEmpty = ~std::uint64_t{0};
+    std::vector<std::uint64_t> slots_;
+};
+
+} // namespace dv
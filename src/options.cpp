@@ -0,0 +1,261 @@
+#include "options.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace dv {
+
+namespace {
+
+const char* next_value(int argc, char** argv, int& i)
+{
+    return i + 1 < argc ? argv[++i] : nullptr;
+}
+
+unsigned parse_count(std::string_view flag, const char* value)
+{
+    if (value == nullptr)
+        throw std::invalid_argument(std::string(flag) + " needs a value");
+    std::size_t used = 0;
+    unsigned long n = 0;
+    try {
+        n = std::stoul(value, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || value[used] != '\0' || n > 4096)
+        throw std::invalid_argument("bad value '" + std::string(value) + "' for " + std::string(flag));
+    return static_cast<unsigned>(n);
+}
+
+Cost parse_bound(std::string_view flag, const char* value)
+{
+    if (value == nullptr)
+        throw std::invalid_argument(std::string(flag) + " needs a value");
+    std::size_t used = 0;
+    long long n = 0;
+    try {
+        n = std::stoll(value, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || value[used] != '\0' || n < 1 || n > kInfinity)
+        throw std::invalid_argument("bad value '" + std::string(value) + "' for " + std::string(flag));
+    return static_cast<Cost>(n);
+}
+
+} // namespace
+
+Options parse_options(int argc, char** argv)
+{
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            opts.help = true;
+        } else if (arg == "--full-recompute") {
+            opts.full_recompute = true;
+        } else if (arg == "--async") {
+            opts.async = true;
+        } else if (arg == "--simulate") {
+            opts.simulate = true;
+        } else if (arg == "--compact") {
+            opts.compact = true;
+        } else if (arg == "--stop-counting") {
+            opts.stop_counting = true;
+        } else if (arg == "--infinity") {
+            opts.infinity = parse_bound(arg, next_value(argc, argv, i));
+            opts.infinity_given = true;
+        } else if (arg == "--verify") {
+            opts.verify = true;
+        } else if (arg == "--live") {
+            opts.live = true;
+        } else if (arg == "--profile" || arg == "--trace") {
+            const char* value = next_value(argc, argv, i);
+            if (value == nullptr)
+                throw std::invalid_argument(std::string(arg) + " needs a file name");
+            (arg == "--profile" ? opts.profile_path : opts.trace_path) = value;
+        } else if (arg == "--save-snapshot" || arg == "--load-snapshot") {
+            const char* value = next_value(argc, argv, i);
+            if (value == nullptr)
+                throw std::invalid_argument(std::string(arg) + " needs a file name");
+            (arg == "--save-snapshot" ? opts.save_snapshot_path : opts.load_snapshot_path) = value;
+        } else if (arg == "--scenarios" || arg == "--scenario-output") {
+            const char* value = next_value(argc, argv, i);
+            if (value == nullptr)
+                throw std::invalid_argument(std::string(arg) + " needs a directory");
+            (arg == "--scenarios" ? opts.scenario_dir : opts.scenario_output_dir) = value;
+        } else if (arg == "--table-dir") {
+            const char* value = next_value(argc, argv, i);
+            if (value == nullptr)
+                throw std::invalid_argument("--table-dir needs a directory");
+            opts.table_dir = value;
+        } else if (arg == "--jobs") {
+            opts.jobs = parse_count(arg, next_value(argc, argv, i));
+        } else if (arg == "--stats") {
+            opts.stats = true;
+        } else if (arg == "--kernel") {
+            const char* value = next_value(argc, argv, i);
+            if (value == nullptr)
+                throw std::invalid_argument("--kernel needs a value");
+            opts.kernel = value;
+        } else if (arg == "--tables") {
+            const char* value = next_value(argc, argv, i);
+            const std::string_view mode = value ? value : "";
+            if (mode == "all")
+                opts.tables = TableOutput::all;
+            else if (mode == "final")
+                opts.tables = TableOutput::final;
+            else if (mode == "changed")
+                opts.tables = TableOutput::changed;
+            else if (mode == "none")
+                opts.tables = TableOutput::none;
+            else
+                throw std::invalid_argument("--tables takes all, final, changed or none");
+            opts.tables_given = true;
+        } else if (arg == "--format") {
+            const char* value = next_value(argc, argv, i);
+            const std::string_view format = value ? value : "";
+            if (format == "text")
+                opts.format = OutputFormat::text;
+            else if (format == "ndjson")
+                opts.format = OutputFormat::ndjson;
+            else if (format == "binary")
+                opts.format = OutputFormat::binary;
+            else
+                throw std::invalid_argument("--format takes text, ndjson or binary");
+        } else if (arg == "--query") {
+            const char* value = next_value(argc, argv, i);
+            if (value == nullptr || *value == '\0')
+                throw std::invalid_argument("--query needs router names");
+            opts.query = value;
+        } else if (arg == "--policy") {
+            const char* value = next_value(argc, argv, i);
+            if (value == nullptr || !parse_policy(value, opts.policy))
+                throw std::invalid_argument("--policy takes plain, split-horizon or poisoned-reverse");
+            opts.policy_given = true;
+        } else if (arg == "--partitions") {
+            opts.partitions = parse_count(arg, next_value(argc, argv, i));
+            if (opts.partitions < 1 || opts.partitions > 16)
+                throw std::invalid_argument("--partitions takes 1 to 16");
+        } else if (arg == "--partition-scheme") {
+            const char* value = next_value(argc, argv, i);
+            if (value == nullptr || !parse_partition_scheme(value, opts.partition_scheme))
+                throw std::invalid_argument("--partition-scheme takes hash or edge-cut");
+        } else if (arg == "--reorder") {
+            const char* value = next_value(argc, argv, i);
+            if (value == nullptr || !parse_node_order(value, opts.reorder))
+                throw std::invalid_argument("--reorder takes input, bfs or rcm");
+        } else if (arg == "--threads") {
+            opts.threads = parse_count(arg, next_value(argc, argv, i));
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            throw std::invalid_argument("unknown option '" + std::string(arg) + "'");
+        } else if (opts.input_path.empty()) {
+            opts.input_path = arg;
+        } else {
+            throw std::invalid_argument("more than one input file given");
+        }
+    }
+    if (opts.async && opts.stop_counting)
+        throw std::invalid_argument("--stop-counting needs rounds and cannot be used with --async");
+    if (opts.format != OutputFormat::text && (opts.async || opts.partitions > 1))
+        throw std::invalid_argument("--format " + std::string(opts.format == OutputFormat::ndjson ? "ndjson" : "binary")
+                                    + " writes per-round deltas and cannot be used with --async or --partitions");
+    if (opts.partitions > 1
+        && (opts.async || opts.stop_counting || opts.verify || opts.live
+            || !opts.save_snapshot_path.empty() || !opts.load_snapshot_path.empty()))
+        throw std::invalid_argument(
+            "--partitions cannot be used with --async, --stop-counting, --verify, --live or snapshots");
+    if (opts.scenario_dir.empty() != opts.scenario_output_dir.empty())
+        throw std::invalid_argument("--scenarios and --scenario-output go together");
+    if (!opts.scenario_dir.empty()
+        && (opts.threads != 1 || opts.live || opts.partitions > 1 || !opts.save_snapshot_path.empty()))
+        throw std::invalid_argument(
+            "--scenarios cannot be used with --threads, --live, --partitions or --save-snapshot");
+    // Forked scenarios would all write to the one shared table file.
+    if (!opts.scenario_dir.empty() && !opts.table_dir.empty())
+        throw std::invalid_argument("--table-dir cannot be used with --scenarios");
+    if (opts.reorder != NodeOrder::input
+        && (opts.partitions > 1 || !opts.save_snapshot_path.empty() || !opts.load_snapshot_path.empty()))
+        throw std::invalid_argument("--reorder cannot be used with --partitions or snapshots");
+    // The simulator has neither rounds nor the engine's tables.
+    if (opts.simulate
+        && (opts.async || opts.threads != 1 || opts.full_recompute || opts.tables_given
+            || opts.format != OutputFormat::text || opts.stop_counting || opts.compact || opts.live
+            || opts.partitions > 1 || opts.reorder != NodeOrder::input || !opts.table_dir.empty()
+            || !opts.scenario_dir.empty() || !opts.save_snapshot_path.empty() || !opts.load_snapshot_path.empty()))
+        throw std::invalid_argument("--simulate can only be combined with --policy, --infinity, --query, "
+                                    "--verify, --stats, --profile and --trace");
+    if (opts.live && !opts.tables_given)
+        opts.tables = TableOutput::none;
+    return opts;
+}
+
+void print_usage(std::ostream& out)
+{
+    out << "usage: DistanceVector [options] [input-file]\n"
+           "Reads the topology from input-file, or from stdin if omitted.\n"
+           "\n"
+           "  --full-recompute   recompute every router every round instead of\n"
+           "                     only those whose inputs changed\n"
+           "  --async            propagate with a worklist instead of rounds; prints\n"
+           "                     only the routing tables\n"
+           "  --simulate         run a discrete-event simulation in which each\n"
+           "                     advertisement takes its link's delay to arrive;\n"
+           "                     prints only the routing tables, and the simulated\n"
+           "                     time each convergence took on stderr\n"
+           "  --threads N        threads per round, or for --async (default 1,\n"
+           "                     0 = all cores)\n"
+           "  --tables MODE      distance tables to print: all (default), final\n"
+           "                     (converged round only), changed (per round,\n"
+           "                     only routers whose table changed) or none\n"
+           "  --format NAME      text (default) prints tables; ndjson and binary\n"
+           "                     instead write each round's route changes as\n"
+           "                     (round, router, destination, old cost, new cost,\n"
+           "                     next hop) records\n"
+           "  --query A,B,...    print tables only for these routers; in --live\n"
+           "                     mode, only their route changes\n"
+           "  --policy NAME      advertisement policy: plain (default), split-horizon\n"
+           "                     or poisoned-reverse\n"
+           "  --infinity N       treat costs of N or more as unreachable (default\n"
+           "                     2^30 - 1)\n"
+           "  --stop-counting    end a convergence once its only changes are routes\n"
+           "                     counting up to unreachable destinations; reports\n"
+           "                     the rounds skipped on stderr\n"
+           "  --compact          keep costs in 16 bits, halving the distance tables;\n"
+           "                     switches to 32 bits if a cost does not fit\n"
+           "  --table-dir DIR    keep the distance tables in a scratch file in DIR,\n"
+           "                     so they can be larger than memory\n"
+           "  --live             keep running and read link changes from stdin as\n"
+           "                     they arrive, printing the routes each batch\n"
+           "                     changes; distance tables default to none\n"
+           "  --save-snapshot FILE\n"
+           "                     write the converged graph and tables at exit\n"
+           "  --load-snapshot FILE\n"
+           "                     start from a saved snapshot; the input is then\n"
+           "                     only the link changes to apply\n"
+           "  --scenarios DIR    after converging, run each file in DIR as an UPDATE\n"
+           "                     section of its own, in a forked copy of the\n"
+           "                     converged state\n"
+           "  --scenario-output DIR\n"
+           "                     where each scenario's output goes, under its name\n"
+           "  --jobs N           scenarios run at once (default 0 = all cores)\n"
+           "  --partitions N     split the routers across N worker processes (1-16)\n"
+           "                     that exchange changed vectors every round\n"
+           "  --partition-scheme NAME\n"
+           "                     how to split them: edge-cut (default), keeping\n"
+           "                     linked routers together, or hash\n"
+           "  --reorder NAME     number routers for locality: input (default), bfs\n"
+           "                     or rcm (reverse Cuthill-McKee); output is unchanged\n"
+           "  --kernel NAME      relaxation kernel: auto, avx512, avx2 or scalar\n"
+           "  --verify           check each converged routing table against shortest\n"
+           "                     paths computed with Dijkstra; exits 1 on mismatch\n"
+           "  --stats            report peak arena usage on stderr at exit\n"
+           "  --profile FILE     write per-phase times and work counters as JSON\n"
+           "  --trace FILE       write a Chrome trace of every timed phase\n"
+           "                     (both need a build with -DDV_INSTRUMENT=ON)\n"
+           "  -h, --help         show this message\n";
+}
+
+} // namespace dv
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "engine.hpp"
+#include "partition.hpp"
+#include "policy.hpp"
+#include "reorder.hpp"
+
+#include <ostream>
+#include <string>
+
+namespace dv {
+
+struct Options {
+    std::string input_path; // empty: read stdin
+    bool full_recompute = false;
+    bool async = false;
+    bool simulate = false; // discrete events with link delays instead of rounds
+    unsigned threads = 1; // 0: one per hardware thread
+    std::string kernel = "auto";
+    TableOutput tables = TableOutput::all;
+    bool tables_given = false; // --live defaults to none instead
+    OutputFormat format = OutputFormat::text;
+    std::string query; // comma-separated routers to print; empty: all
+    PolicyKind policy = PolicyKind::plain;
+    Cost infinity = kInfinity;
+    bool policy_given = false; // else a loaded snapshot's apply
+    bool infinity_given = false;
+    bool stop_counting = false;
+    bool compact = false;
+    std::string table_dir; // empty: tables in memory
+    bool verify = false;
+    bool live = false;
+    unsigned partitions = 1; // above 1, one worker process per partition
+    PartitionScheme partition_scheme = PartitionScheme::edge_cut;
+    NodeOrder reorder = NodeOrder::input;
+    std::string save_snapshot_path;
+    std::string load_snapshot_path; // input is then the UPDATE section alone
+    std::string scenario_dir; // UPDATE sections to run from the converged base
+    std::string scenario_output_dir;
+    unsigned jobs = 0; // scenarios at once; 0: one per hardware thread
+    std::string profile_path; // instrumentation summary, if built in
+    std::string trace_path;
+    bool stats = false;
+    bool help = false;
+};
+
+// Throws std::invalid_argument on unknown or malformed flags.
+Options parse_options(int argc, char** argv);
+void print_usage(std::ostream& out);
+
+} // namespace dv
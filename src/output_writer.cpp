@@ -0,0 +1,123 @@
+#include "output_writer.hpp"
+
+#include "instrument.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+namespace dv {
+
+namespace {
+
+constexpr char kDigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+} // namespace
+
+OutputWriter::OutputWriter(int fd, std::size_t capacity)
+    : fd_(fd)
+    , buf_(capacity)
+{
+}
+
+OutputWriter::~OutputWriter()
+{
+    try {
+        line_start_ = used_;
+        flush();
+    } catch (const std::exception&) {
+    }
+}
+
+void OutputWriter::append(const char* data, std::size_t size)
+{
+    std::memcpy(buf_.data() + used_, data, size);
+    used_ += size;
+}
+
+void OutputWriter::spaces(std::size_t count)
+{
+    reserve(count);
+    std::memset(buf_.data() + used_, ' ', count);
+    used_ += count;
+}
+
+std::size_t OutputWriter::write_uint(std::uint64_t value)
+{
+    char tmp[20];
+    char* p = tmp + sizeof(tmp);
+    while (value >= 100) {
+        const auto pair = static_cast<std::size_t>(value % 100) * 2;
+        value /= 100;
+        *--p = kDigitPairs[pair + 1];
+        *--p = kDigitPairs[pair];
+    }
+    if (value >= 10) {
+        const auto pair = static_cast<std::size_t>(value) * 2;
+        *--p = kDigitPairs[pair + 1];
+        *--p = kDigitPairs[pair];
+    } else {
+        *--p = static_cast<char>('0' + value);
+    }
+    const auto len = static_cast<std::size_t>(tmp + sizeof(tmp) - p);
+    reserve(len);
+    append(p, len);
+    return len;
+}
+
+std::size_t OutputWriter::write_int(std::int64_t value)
+{
+    if (value >= 0)
+        return write_uint(static_cast<std::uint64_t>(value));
+    put('-');
+    return 1 + write_uint(0 - static_cast<std::uint64_t>(value));
+}
+
+void OutputWriter::end_line()
+{
+    while (used_ > line_start_ && buf_[used_ - 1] == ' ')
+        --used_;
+    put('\n');
+    line_start_ = used_;
+}
+
+void OutputWriter::flush()
+{
+    DV_SCOPE("write");
+    std::size_t done = 0;
+    while (done < line_start_) {
+        ssize_t n = ::write(fd_, buf_.data() + done, line_start_ - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("cannot write output: ") + std::strerror(errno));
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    // Keep the unfinished line at the front of the buffer.
+    std::memmove(buf_.data(), buf_.data() + line_start_, used_ - line_start_);
+    used_ -= line_start_;
+    line_start_ = 0;
+}
+
+void OutputWriter::make_room(std::size_t bytes)
+{
+    flush();
+    if (buf_.size() - used_ < bytes)
+        buf_.resize(used_ + bytes);
+}
+
+} // namespace dv
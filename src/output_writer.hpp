@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace dv {
+
+// Buffered writer for the table dumps. Text accumulates in one large
+// reusable buffer that is written to the file descriptor in big chunks,
+// always at line boundaries so end_line() can strip trailing padding.
+class OutputWriter {
+public:
+    explicit OutputWriter(int fd, std::size_t capacity = std::size_t(1) << 20);
+    ~OutputWriter();
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    void write(std::string_view text)
+    {
+        reserve(text.size());
+        append(text.data(), text.size());
+    }
+
+    void put(char c)
+    {
+        reserve(1);
+        buf_[used_++] = c;
+    }
+
+    void spaces(std::size_t count);
+
+    // Decimal text of value; returns the number of characters written.
+    std::size_t write_uint(std::uint64_t value);
+    std::size_t write_int(std::int64_t value);
+
+    // Drops trailing spaces from the current line and terminates it.
+    void end_line();
+
+    // Appends whole lines of finished text, each ending in a newline, at a
+    // line boundary.
+    void write_lines(std::string_view text)
+    {
+        write(text);
+        line_start_ = used_;
+    }
+
+    // Appends binary records, which are never split by a flush or
+    // touched by end_line().
+    void write_bytes(const void* data, std::size_t size)
+    {
+        reserve(size);
+        append(static_cast<const char*>(data), size);
+        line_start_ = used_;
+    }
+
+    // Writes everything up to the last completed line. Throws
+    // std::runtime_error if the descriptor rejects the data.
+    void flush();
+
+private:
+    void reserve(std::size_t bytes)
+    {
+        if (buf_.size() - used_ < bytes)
+            make_room(bytes);
+    }
+    void make_room(std::size_t bytes);
+    void append(const char* data, std::size_t size);
+
+    int fd_;
+    std::vector<char> buf_;
+    std::size_t used_ = 0;
+    std::size_t line_start_ = 0;
+};
+
+} // namespace dv
@@ -0,0 +1,130 @@
+#include "partition.hpp"
+
+#include <algorithm>
+
+namespace dv {
+
+namespace {
+
+constexpr std::uint32_t kUnassigned = ~std::uint32_t{0};
+constexpr int kRefinePasses = 4;
+
+// Grows each part breadth-first from the lowest unassigned router, moving
+// on to a new seed when a connected region runs out.
+void grow_regions(const Graph& net, unsigned parts, std::vector<std::uint32_t>& part)
+{
+    const NodeId n = net.node_count();
+    const NodeId* targets = net.targets();
+    std::vector<NodeId> queue;
+    NodeId seed = 0;
+    for (unsigned p = 0; p < parts; ++p) {
+        const NodeId target = static_cast<NodeId>(std::uint64_t{n} * (p + 1) / parts - std::uint64_t{n} * p / parts);
+        NodeId size = 0;
+        std::size_t head = 0;
+        queue.clear();
+        while (size < target) {
+            if (head == queue.size()) {
+                while (part[seed] != kUnassigned)
+                    ++seed;
+                queue.push_back(seed);
+            }
+            const NodeId u = queue[head++];
+            if (part[u] != kUnassigned)
+                continue;
+            part[u] = p;
+            ++size;
+            for (auto e = net.offset(u), end = net.offset(u + 1); e < end; ++e) {
+                if (part[targets[e]] == kUnassigned)
+                    queue.push_back(targets[e]);
+            }
+        }
+    }
+}
+
+// Greedy boundary refinement: a router moves to the neighbouring part
+// that holds most of its links if that cuts more links than it adds and
+// both parts stay within a few percent of an even split.
+void refine(const Graph& net, unsigned parts, std::vector<std::uint32_t>& part)
+{
+    const NodeId n = net.node_count();
+    const NodeId* targets = net.targets();
+    const NodeId even = n / parts;
+    const NodeId most = (n + parts - 1) / parts + even / 32;
+    const NodeId least = even - even / 32;
+
+    std::vector<NodeId> size(parts, 0);
+    for (NodeId x = 0; x < n; ++x)
+        ++size[part[x]];
+    std::vector<std::uint32_t> links(parts, 0);
+    std::vector<std::uint32_t> seen;
+    for (int pass = 0; pass < kRefinePasses; ++pass) {
+        NodeId moved = 0;
+        for (NodeId u = 0; u < n; ++u) {
+            const std::uint32_t from = part[u];
+            seen.clear();
+            for (auto e = net.offset(u), end = net.offset(u + 1); e < end; ++e) {
+                const std::uint32_t q = part[targets[e]];
+                if (links[q]++ == 0)
+                    seen.push_back(q);
+            }
+            std::uint32_t best = from;
+            for (std::uint32_t q : seen) {
+                if (links[q] > links[best])
+                    best = q;
+            }
+            if (best != from && links[best] > links[from] && size[best] < most && size[from] > least) {
+                part[u] = best;
+                --size[from];
+                ++size[best];
+                ++moved;
+            }
+            for (std::uint32_t q : seen)
+                links[q] = 0;
+        }
+        if (moved == 0)
+            break;
+    }
+}
+
+} // namespace
+
+bool parse_partition_scheme(std::string_view name, PartitionScheme& scheme)
+{
+    if (name == "hash")
+        scheme = PartitionScheme::hash;
+    else if (name == "edge-cut")
+        scheme = PartitionScheme::edge_cut;
+    else
+        return false;
+    return true;
+}
+
+std::vector<std::uint32_t> partition_routers(const Graph& net, unsigned parts, PartitionScheme scheme)
+{
+    const NodeId n = net.node_count();
+    std::vector<std::uint32_t> part(n, 0);
+    if (parts <= 1)
+        return part;
+    if (scheme == PartitionScheme::hash) {
+        for (NodeId x = 0; x < n; ++x)
+            part[x] = x % parts;
+        return part;
+    }
+    std::fill(part.begin(), part.end(), kUnassigned);
+    grow_regions(net, parts, part);
+    refine(net, parts, part);
+    return part;
+}
+
+std::uint64_t cut_links(const Graph& net, const std::vector<std::uint32_t>& part)
+{
+    std::uint64_t cut = 0;
+    const NodeId* targets = net.targets();
+    for (NodeId x = 0; x < net.node_count(); ++x) {
+        for (auto e = net.offset(x), end = net.offset(x + 1); e < end; ++e)
+            cut += x < targets[e] && part[x] != part[targets[e]];
+    }
+    return cut;
+}
+
+} // namespace dv
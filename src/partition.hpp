@@ -0,0 +1,33 @@
+#pragma once
+
+#include "graph.hpp"
+#include "names.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace dv {
+
+enum class PartitionScheme {
+    hash,     // routers dealt out by ID modulo the number of parts
+    edge_cut, // connected regions grown breadth-first, then refined
+};
+
+bool parse_partition_scheme(std::string_view name, PartitionScheme& scheme);
+
+// Assigns every router of net to one of parts partitions of nearly equal
+// size: within a few percent of n / parts.
+//
+// edge_cut is a single-level take on METIS-style partitioning: each part
+// is grown breadth-first from the lowest unassigned router until it is
+// full, then routers on a boundary are moved, a few passes over, to the
+// neighbouring part holding more of their links while the sizes stay in
+// balance. It keeps clustered topologies' cuts small; hash ignores the
+// links entirely.
+std::vector<std::uint32_t> partition_routers(const Graph& net, unsigned parts, PartitionScheme scheme);
+
+// Links whose endpoints are in different partitions.
+std::uint64_t cut_links(const Graph& net, const std::vector<std::uint32_t>& part);
+
+} // namespace dv
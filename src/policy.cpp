@@ -0,0 +1,31 @@
+#include "policy.hpp"
+
+namespace dv {
+
+bool parse_policy(std::string_view name, PolicyKind& kind)
+{
+    if (name == Plain::kName)
+        kind = PolicyKind::plain;
+    else if (name == SplitHorizon::kName)
+        kind = PolicyKind::split_horizon;
+    else if (name == PoisonedReverse::kName)
+        kind = PolicyKind::poisoned_reverse;
+    else
+        return false;
+    return true;
+}
+
+const char* policy_name(PolicyKind kind)
+{
+    switch (kind) {
+    case PolicyKind::plain:
+        return Plain::kName;
+    case PolicyKind::split_horizon:
+        return SplitHorizon::kName;
+    case PolicyKind::poisoned_reverse:
+        return PoisonedReverse::kName;
+    }
+    return "unknown";
+}
+
+} // namespace dv
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "cost.hpp"
+#include "names.hpp"
+
+#include <string_view>
+
+namespace dv {
+
+enum class PolicyKind { plain, split_horizon, poisoned_reverse };
+
+// Advertisement policies. Each is a compile-time parameter of Engine, so
+// every variant gets its own relaxation loop with no per-entry branch on
+// the policy.
+
+// Every route is advertised to every neighbour as is.
+struct Plain {
+    static constexpr const char* kName = "plain";
+    static constexpr PolicyKind kKind = PolicyKind::plain;
+    static constexpr bool kPoisons = false;
+};
+
+// Routes are not advertised to the neighbour they were learned from. With
+// whole-vector exchange that neighbour holds no entry for them, so its
+// table shows them as INF, exactly as under poisoned reverse; only the
+// wire format would differ.
+struct SplitHorizon {
+    static constexpr const char* kName = "split-horizon";
+    static constexpr PolicyKind kKind = PolicyKind::split_horizon;
+    static constexpr bool kPoisons = true;
+};
+
+// Routes are advertised back to the neighbour they were learned from with
+// an infinite cost.
+struct PoisonedReverse {
+    static constexpr const char* kName = "poisoned-reverse";
+    static constexpr PolicyKind kKind = PolicyKind::poisoned_reverse;
+    static constexpr bool kPoisons = true;
+};
+
+// The cost a router whose route to some destination has the given cost and
+// next hop advertises for it to neighbour `to`.
+template <typename Policy>
+constexpr Cost advertised(Cost cost, NodeId via, NodeId to)
+{
+    if constexpr (Policy::kPoisons)
+        return via == to ? kInfinity : cost;
+    else
+        return cost;
+}
+
+bool parse_policy(std::string_view name, PolicyKind& kind);
+const char* policy_name(PolicyKind kind);
+
+} // namespace dv
@@ -0,0 +1,149 @@
+#include "reorder.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace dv {
+
+namespace {
+
+struct Levels {
+    std::size_t depth = 0; // levels below the start
+    std::size_t last = 0;  // where the deepest level begins in the sequence
+};
+
+// Breadth-first from start, appending newly reached routers to sequence;
+// with by_degree, each router's new neighbours are queued by ascending
+// degree instead of by ID.
+Levels visit(const Graph& net, NodeId start, bool by_degree, std::vector<std::uint8_t>& seen,
+             std::vector<NodeId>& sequence)
+{
+    const NodeId* targets = net.targets();
+    Levels levels;
+    std::size_t head = sequence.size();
+    std::size_t level_end = head + 1;
+    levels.last = head;
+    sequence.push_back(start);
+    seen[start] = 1;
+    while (head < sequence.size()) {
+        if (head == level_end) {
+            ++levels.depth;
+            levels.last = head;
+            level_end = sequence.size();
+        }
+        const NodeId u = sequence[head++];
+        const std::size_t first = sequence.size();
+        for (auto e = net.offset(u), end = net.offset(u + 1); e < end; ++e) {
+            if (!seen[targets[e]]) {
+                seen[targets[e]] = 1;
+                sequence.push_back(targets[e]);
+            }
+        }
+        if (by_degree) {
+            std::stable_sort(sequence.begin() + first, sequence.end(),
+                             [&](NodeId a, NodeId b) { return net.degree(a) < net.degree(b); });
+        }
+    }
+    return levels;
+}
+
+// A router on the rim of start's component, by George and Liu's search:
+// move to a lowest-degree router of the deepest level for as long as that
+// makes the search deeper.
+NodeId peripheral(const Graph& net, NodeId start, std::vector<std::uint8_t>& seen)
+{
+    std::vector<NodeId> sequence;
+    auto search = [&](NodeId from) {
+        sequence.clear();
+        const Levels levels = visit(net, from, false, seen, sequence);
+        for (const NodeId x : sequence)
+            seen[x] = 0;
+        return levels;
+    };
+    Levels levels = search(start);
+    while (true) {
+        NodeId next = sequence[levels.last];
+        for (std::size_t i = levels.last; i < sequence.size(); ++i) {
+            if (net.degree(sequence[i]) < net.degree(next))
+                next = sequence[i];
+        }
+        const Levels further = search(next);
+        if (further.depth <= levels.depth)
+            return start;
+        start = next;
+        levels = further;
+    }
+}
+
+} // namespace
+
+bool parse_node_order(std::string_view name, NodeOrder& order)
+{
+    if (name == "input")
+        order = NodeOrder::input;
+    else if (name == "bfs")
+        order = NodeOrder::bfs;
+    else if (name == "rcm")
+        order = NodeOrder::rcm;
+    else
+        return false;
+    return true;
+}
+
+std::vector<NodeId> order_routers(const Graph& net, NodeOrder order)
+{
+    const NodeId n = net.node_count();
+    std::vector<NodeId> sequence;
+    sequence.reserve(n);
+    if (order == NodeOrder::input) {
+        for (NodeId x = 0; x < n; ++x)
+            sequence.push_back(x);
+        return sequence;
+    }
+    std::vector<std::uint8_t> seen(n, 0);
+    for (NodeId x = 0; x < n; ++x) {
+        if (seen[x])
+            continue;
+        if (order == NodeOrder::bfs)
+            visit(net, x, false, seen, sequence);
+        else
+            visit(net, peripheral(net, x, seen), true, seen, sequence);
+    }
+    if (order == NodeOrder::rcm)
+        std::reverse(sequence.begin(), sequence.end());
+    return sequence;
+}
+
+void renumber(Topology& topo, const std::vector<NodeId>& sequence)
+{
+    const NodeId n = topo.names.size();
+    std::vector<NodeId> id(n);
+    NameTable names;
+    for (NodeId k = 0; k < n; ++k) {
+        id[sequence[k]] = k;
+        names.add(topo.names.name(sequence[k]));
+    }
+    names.build_index();
+    for (auto* lines : {&topo.links, &topo.updates}) {
+        for (LinkLine& link : *lines) {
+            link.a = id[link.a];
+            link.b = id[link.b];
+        }
+    }
+    // Declaration positions carry over from an earlier renumbering.
+    std::vector<NodeId> rank(n);
+    for (NodeId k = 0; k < n; ++k)
+        rank[k] = topo.rank.empty() ? sequence[k] : topo.rank[sequence[k]];
+    topo.names = std::move(names);
+    topo.rank = std::move(rank);
+}
+
+NodeId bandwidth(const Topology& topo)
+{
+    NodeId widest = 0;
+    for (const LinkLine& link : topo.links)
+        widest = std::max(widest, link.a > link.b ? link.a - link.b : link.b - link.a);
+    return widest;
+}
+
+} // namespace dv
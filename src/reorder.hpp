@@ -0,0 +1,35 @@
+#pragma once
+
+#include "graph.hpp"
+#include "input.hpp"
+#include "names.hpp"
+
+#include <string_view>
+#include <vector>
+
+namespace dv {
+
+enum class NodeOrder {
+    input, // declaration order
+    bfs,   // breadth-first from the first declared router of each component
+    rcm,   // reverse Cuthill-McKee
+};
+
+bool parse_node_order(std::string_view name, NodeOrder& order);
+
+// The routers of net in the order to number them: linked routers end up
+// with nearby IDs, so a router's neighbours' vectors sit close together
+// in the tables. rcm starts each component from a low-degree router on
+// its rim and visits neighbours by ascending degree, then reverses the
+// whole sequence, which keeps the ID gap across links small.
+std::vector<NodeId> order_routers(const Graph& net, NodeOrder order);
+
+// Renumbers topo's routers so that sequence[k] becomes router k. Names,
+// links and updates follow, and topo.rank records where each router was
+// declared.
+void renumber(Topology& topo, const std::vector<NodeId>& sequence);
+
+// The largest ID gap across any of topo's links.
+NodeId bandwidth(const Topology& topo);
+
+} // namespace dv
@@ -0,0 +1,89 @@
+#include "route_matrix.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace dv {
+
+namespace {
+
+template <typename T>
+T* allocate(std::size_t count)
+{
+    void* p = std::aligned_alloc(RouteMatrix::kAlignment, std::max<std::size_t>(count, 1) * sizeof(T));
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return static_cast<T*>(p);
+}
+
+} // namespace
+
+template <typename Entry>
+BasicRouteMatrix<Entry>::BasicRouteMatrix(NodeId rows)
+    : rows_(rows)
+    , stride_(stride_for(rows))
+    , dist_(allocate<Entry>(rows * stride_))
+    , via_(allocate<NodeId>(rows * stride_))
+{
+    for (NodeId x = 0; x < rows_; ++x)
+        clear_row(x);
+}
+
+template <typename Entry>
+BasicRouteMatrix<Entry> BasicRouteMatrix<Entry>::borrow(NodeId rows, Entry* dist, NodeId* via)
+{
+    BasicRouteMatrix m;
+    m.rows_ = rows;
+    m.stride_ = stride_for(rows);
+    m.dist_ = std::unique_ptr<Entry[], Free>(dist, Free{false});
+    m.via_ = std::unique_ptr<NodeId[], Free>(via, Free{false});
+    return m;
+}
+
+template <typename Entry>
+BasicRouteMatrix<Entry> BasicRouteMatrix<Entry>::sparse(NodeId rows, TableFile* file)
+{
+    BasicRouteMatrix m;
+    m.rows_ = rows;
+    m.stride_ = stride_for(rows);
+    m.lazy_dist_ = LazyArray<Entry>(std::max<std::size_t>(rows * m.stride_, 1), file);
+    m.lazy_via_ = LazyArray<NodeId>(std::max<std::size_t>(rows * m.stride_, 1), file);
+    m.dist_ = std::unique_ptr<Entry[], Free>(m.lazy_dist_.data(), Free{false});
+    m.via_ = std::unique_ptr<NodeId[], Free>(m.lazy_via_.data(), Free{false});
+    return m;
+}
+
+template <typename Entry>
+BasicRouteMatrix<Entry> BasicRouteMatrix<Entry>::uninitialized(NodeId rows)
+{
+    BasicRouteMatrix m;
+    m.rows_ = rows;
+    m.stride_ = stride_for(rows);
+    m.dist_.reset(allocate<Entry>(rows * m.stride_));
+    m.via_.reset(allocate<NodeId>(rows * m.stride_));
+    for (NodeId x = 0; x < rows; ++x) {
+        std::fill(m.dist(x) + rows, m.dist(x) + m.stride_, kUnreachable<Entry>);
+        std::fill(m.via(x) + rows, m.via(x) + m.stride_, kNoNode);
+    }
+    return m;
+}
+
+template <typename Entry>
+void BasicRouteMatrix<Entry>::clear_row(NodeId x)
+{
+    clear_row(x, 0, stride_);
+}
+
+template <typename Entry>
+void BasicRouteMatrix<Entry>::clear_row(NodeId x, std::size_t begin, std::size_t end)
+{
+    if (begin < end) {
+        std::fill(dist(x) + begin, dist(x) + end, kUnreachable<Entry>);
+        std::fill(via(x) + begin, via(x) + end, kNoNode);
+    }
+}
+
+template class BasicRouteMatrix<Cost>;
+template class BasicRouteMatrix<CompactCost>;
+
+} // namespace dv
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "cost.hpp"
+#include "lazy_array.hpp"
+#include "names.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+
+namespace dv {
+
+// One router's vector, a row of some RouteMatrix.
+struct RouteRow {
+    const Cost* dist;
+    const NodeId* via;
+};
+
+// One distance vector per router as flat row-major storage: row x holds
+// the cost from x to every destination, as Entry (Cost or CompactCost),
+// and the next hop used. Rows are padded to whole cache lines and 64-byte
+// aligned so vector kernels can run over the full stride; padding always
+// holds unreachable entries.
+template <typename Entry>
+class BasicRouteMatrix {
+public:
+    static constexpr std::size_t kAlignment = 64;
+    static constexpr std::size_t kLane = kAlignment / sizeof(Entry);
+
+    BasicRouteMatrix() = default;
+
+    // Every entry starts unreachable.
+    explicit BasicRouteMatrix(NodeId rows);
+
+    // Rows over storage owned by someone else, such as a mapped snapshot,
+    // laid out with stride_for(rows).
+    static BasicRouteMatrix borrow(NodeId rows, Entry* dist, NodeId* via);
+    // Only the padding is initialised: every row must be written in full
+    // before it is read.
+    static BasicRouteMatrix uninitialized(NodeId rows);
+    // Zero-filled rows that take memory only once touched; every row
+    // used must be cleared first. With a file, the rows live there.
+    static BasicRouteMatrix sparse(NodeId rows, TableFile* file = nullptr);
+
+    static std::size_t stride_for(NodeId rows) { return (rows + kLane - 1) / kLane * kLane; }
+
+    NodeId rows() const { return rows_; }
+    std::size_t stride() const { return stride_; }
+
+    Entry* dist(NodeId x) { return dist_.get() + x * stride_; }
+    const Entry* dist(NodeId x) const { return dist_.get() + x * stride_; }
+    NodeId* via(NodeId x) { return via_.get() + x * stride_; }
+    const NodeId* via(NodeId x) const { return via_.get() + x * stride_; }
+
+    // Resets row x, or its entries [begin, end), to unreachable.
+    void clear_row(NodeId x);
+    void clear_row(NodeId x, std::size_t begin, std::size_t end);
+
+private:
+    // Borrowed storage is not freed.
+    struct Free {
+        Free()
+            : owned(true)
+        {
+        }
+        explicit Free(bool owned)
+            : owned(owned)
+        {
+        }
+        bool owned;
+        void operator()(void* p) const
+        {
+            if (owned)
+                std::free(p);
+        }
+    };
+
+    NodeId rows_ = 0;
+    std::size_t stride_ = 0;
+    std::unique_ptr<Entry[], Free> dist_;
+    std::unique_ptr<NodeId[], Free> via_;
+    // Backing for sparse(), which the pointers above borrow.
+    LazyArray<Entry> lazy_dist_;
+    LazyArray<NodeId> lazy_via_;
+};
+
+using RouteMatrix = BasicRouteMatrix<Cost>;
+using CompactRouteMatrix = BasicRouteMatrix<CompactCost>;
+
+} // namespace dv
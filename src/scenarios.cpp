@@ -0,0 +1,120 @@
+#include "scenarios.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace dv {
+
+namespace {
+
+[[noreturn]] void fail(const std::string& what)
+{
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// Runs one scenario in a freshly forked process.
+int run_child(const Scenario& scenario, const std::function<int(const Scenario&, OutputWriter&)>& body)
+{
+    try {
+        const int fd = ::open(scenario.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            fail("cannot create " + scenario.output);
+        int code = 0;
+        {
+            OutputWriter out(fd);
+            code = body(scenario, out);
+            out.flush();
+        }
+        if (::close(fd) != 0)
+            fail("cannot write " + scenario.output);
+        return code;
+    } catch (const std::exception& e) {
+        std::cerr << "DistanceVector: scenario " << scenario.name << ": " << e.what() << '\n';
+        return 1;
+    }
+}
+
+} // namespace
+
+std::vector<Scenario> list_scenarios(const std::string& dir, const std::string& out_dir)
+{
+    struct stat in_stat, out_stat;
+    if (::stat(dir.c_str(), &in_stat) != 0)
+        fail("cannot read " + dir);
+    if (::mkdir(out_dir.c_str(), 0755) != 0 && errno != EEXIST)
+        fail("cannot create " + out_dir);
+    if (::stat(out_dir.c_str(), &out_stat) != 0 || !S_ISDIR(out_stat.st_mode))
+        throw std::runtime_error("'" + out_dir + "' is not a directory");
+    if (in_stat.st_dev == out_stat.st_dev && in_stat.st_ino == out_stat.st_ino)
+        throw std::runtime_error("scenario output would overwrite the scenarios in '" + dir + "'");
+
+    DIR* listing = ::opendir(dir.c_str());
+    if (listing == nullptr)
+        fail("cannot read " + dir);
+    std::vector<Scenario> scenarios;
+    while (const dirent* entry = ::readdir(listing)) {
+        const std::string name = entry->d_name;
+        const std::string path = dir + "/" + name;
+        struct stat file;
+        if (name[0] == '.' || ::stat(path.c_str(), &file) != 0 || !S_ISREG(file.st_mode))
+            continue;
+        scenarios.push_back({name, path, out_dir + "/" + name});
+    }
+    ::closedir(listing);
+    std::sort(scenarios.begin(), scenarios.end(),
+              [](const Scenario& a, const Scenario& b) { return a.name < b.name; });
+    return scenarios;
+}
+
+std::size_t run_scenarios(const std::vector<Scenario>& scenarios, unsigned jobs,
+                          const std::function<int(const Scenario&, OutputWriter&)>& body)
+{
+    if (jobs == 0)
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+    std::cout.flush();
+    std::unordered_map<pid_t, std::size_t> running;
+    std::size_t next = 0;
+    std::size_t failed = 0;
+    while (next < scenarios.size() || !running.empty()) {
+        if (next < scenarios.size() && running.size() < jobs) {
+            const pid_t pid = ::fork();
+            if (pid < 0)
+                fail("cannot start a scenario process");
+            if (pid == 0)
+                ::_exit(run_child(scenarios[next], body));
+            running.emplace(pid, next++);
+            continue;
+        }
+        int status = 0;
+        const pid_t pid = ::waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR)
+                continue;
+            fail("cannot wait for a scenario process");
+        }
+        const auto it = running.find(pid);
+        if (it == running.end())
+            continue;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            if (!WIFEXITED(status))
+                std::cerr << "DistanceVector: scenario " << scenarios[it->second].name << " was killed\n";
+            ++failed;
+        }
+        running.erase(it);
+    }
+    return failed;
+}
+
+} // namespace dv
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "output_writer.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace dv {
+
+// One UPDATE section to run against the converged base topology.
+struct Scenario {
+    std::string name;
+    std::string input;  // the section, as parse_updates() reads it
+    std::string output; // what applying it prints
+};
+
+// A scenario per regular file in dir, by name, each printing to the file
+// of the same name in out_dir, which is created if missing. Throws
+// std::runtime_error if a directory cannot be used or both are the same.
+std::vector<Scenario> list_scenarios(const std::string& dir, const std::string& out_dir);
+
+// Runs body for every scenario in its own process, forked from this one
+// so it starts from a copy-on-write image of the caller's state, with at
+// most jobs running at once (0: one per hardware thread). body prints to
+// the scenario's output file and returns the process's exit code; if it
+// throws, the error is reported on stderr and the code is 1. Returns the
+// number of scenarios that failed.
+//
+// Threads do not survive fork(), so body must not use a thread pool
+// with more than the calling thread.
+std::size_t run_scenarios(const std::vector<Scenario>& scenarios, unsigned jobs,
+                          const std::function<int(const Scenario&, OutputWriter&)>& body);
+
+} // namespace dv
@@ -0,0 +1,41 @@
+#include "shard_mesh.hpp"
+
+namespace dv {
+
+ShardMesh::ShardMesh(std::uint32_t shards, std::size_t ring_capacity)
+    : shards_(shards)
+    , rings_(std::size_t{shards} * shards)
+    , unsent_(shards)
+{
+    for (std::uint32_t from = 0; from < shards; ++from) {
+        for (std::uint32_t to = 0; to < shards; ++to) {
+            if (from != to)
+                rings_[from * shards + to] = std::make_unique<Ring>(ring_capacity);
+        }
+    }
+}
+
+void ShardMesh::start()
+{
+    work_ = shards_;
+    stopping_ = false;
+}
+
+bool ShardMesh::wait_for_work(std::uint32_t s)
+{
+    --work_;
+    while (!stopped()) {
+        for (std::uint32_t from = 0; from < shards_; ++from) {
+            if (from != s && !ring(from, s).empty()) {
+                ++work_;
+                return true;
+            }
+        }
+        if (work_.load() == 0)
+            return false;
+        std::this_thread::yield();
+    }
+    return false;
+}
+
+} // namespace dv
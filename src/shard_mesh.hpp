@@ -0,0 +1,116 @@
+#pragma once
+
+#include "cost.hpp"
+#include "names.hpp"
+#include "spsc_ring.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dv {
+
+// One changed entry of a router's vector, as sent between shards.
+struct Advertisement {
+    NodeId router;
+    NodeId dest;
+    Cost dist;
+    NodeId via;
+};
+
+// Transport and termination for a sharded asynchronous run, one thread
+// per shard. Every ordered pair of shards has a lock-free ring, and one
+// counter holds the shards still busy plus the advertisements sent but
+// not yet delivered. A send counts its batch before pushing it, and a
+// shard going idle uncounts itself only once its queue is empty, so the
+// counter reaches zero only when nothing is left anywhere, and from
+// there nothing can raise it again. Any shard can stop the run early;
+// what is still on its way is then left for flush().
+class ShardMesh {
+public:
+    static constexpr std::size_t kRingCapacity = 1 << 12;
+
+    explicit ShardMesh(std::uint32_t shards, std::size_t ring_capacity = kRingCapacity);
+
+    std::uint32_t shards() const { return shards_; }
+
+    // Starts a run with every shard busy. Not thread-safe; call it before
+    // the shards' threads start.
+    void start();
+    void stop() { stopping_ = true; }
+    bool stopped() const { return stopping_.load(std::memory_order_relaxed); }
+
+    // Shard from: sends count advertisements to shard to, in order. While
+    // to's ring is full, from's own rings are drained through deliver, so
+    // two shards never wait on each other's full rings. After a stop,
+    // whatever did not fit is kept for flush().
+    template <typename Deliver>
+    void send(std::uint32_t from, std::uint32_t to, const Advertisement* batch, std::size_t count,
+              Deliver&& deliver)
+    {
+        work_ += count;
+        std::size_t sent = 0;
+        while (true) {
+            sent += ring(from, to).push(batch + sent, count - sent);
+            if (sent == count)
+                return;
+            if (stopped())
+                break;
+            if (!receive(from, deliver))
+                std::this_thread::yield();
+        }
+        for (; sent < count; ++sent)
+            unsent_[from].push_back({to, batch[sent]});
+    }
+
+    // Shard s: calls deliver(ad) on every advertisement waiting for it,
+    // each sender's in order; returns whether there were any.
+    template <typename Deliver>
+    bool receive(std::uint32_t s, Deliver&& deliver)
+    {
+        std::size_t received = 0;
+        for (std::uint32_t from = 0; from < shards_; ++from) {
+            if (from != s)
+                received += ring(from, s).drain(deliver);
+        }
+        work_ -= received;
+        return received != 0;
+    }
+
+    // Shard s, with nothing left to do: waits for an advertisement to
+    // arrive, returning true, or for the run to end or stop, returning
+    // false.
+    bool wait_for_work(std::uint32_t s);
+
+    // Once a stopped run's threads have returned: calls deliver(to, ad) on
+    // every advertisement still on its way, the rings' before any kept by
+    // send(), so each sender's stay in order.
+    template <typename Deliver>
+    void flush(Deliver&& deliver)
+    {
+        for (std::uint32_t to = 0; to < shards_; ++to)
+            receive(to, [&](const Advertisement& ad) { deliver(to, ad); });
+        for (auto& unsent : unsent_) {
+            for (const auto& [to, ad] : unsent)
+                deliver(to, ad);
+            work_ -= unsent.size();
+            unsent.clear();
+        }
+    }
+
+private:
+    using Ring = SpscRing<Advertisement>;
+    Ring& ring(std::uint32_t from, std::uint32_t to) { return *rings_[from * shards_ + to]; }
+
+    std::uint32_t shards_;
+    std::vector<std::unique_ptr<Ring>> rings_; // [from * shards_ + to]
+    std::vector<std::vector<std::pair<std::uint32_t, Advertisement>>> unsent_; // per sender
+    std::atomic<std::uint64_t> work_{0};
+    std::atomic<bool> stopping_{false};
+};
+
+} // namespace dv
@@ -0,0 +1,339 @@
+#include "snapshot.hpp"
+
+#include "instrument.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dv {
+
+namespace {
+
+constexpr char kMagic[8] = {'D', 'V', 'S', 'N', 'A', 'P', '\r', '\n'};
+constexpr std::uint32_t kByteOrder = 0x01020304;
+constexpr std::uint64_t kAlign = RouteMatrix::kAlignment;
+
+// Section positions are byte offsets from the start of the file.
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t nodes;
+    std::uint32_t policy;
+    std::int32_t infinity;
+    std::int32_t round;
+    std::uint64_t entries; // CSR entries, two per link
+    std::uint64_t stride;
+    std::uint64_t name_bytes;
+    std::uint64_t name_index; // u32[nodes + 1] into the name text
+    std::uint64_t name_text;
+    std::uint64_t offsets; // u32[nodes + 1]
+    std::uint64_t targets; // u32[entries]
+    std::uint64_t costs;   // i32[entries]
+    std::uint64_t dist;    // i32[nodes * stride]
+    std::uint64_t via;     // u32[nodes * stride]
+    std::uint64_t file_size;
+};
+
+std::uint64_t align_up(std::uint64_t n)
+{
+    return (n + kAlign - 1) / kAlign * kAlign;
+}
+
+// start + count * width, or UINT64_MAX, which no file reaches, if that
+// overflows.
+std::uint64_t section_end(std::uint64_t start, std::uint64_t count, std::uint64_t width)
+{
+    std::uint64_t bytes;
+    std::uint64_t end;
+    if (__builtin_mul_overflow(count, width, &bytes) || __builtin_add_overflow(start, bytes, &end))
+        return UINT64_MAX;
+    return end;
+}
+
+// err is the failed call's errno, saved before any cleanup can change it.
+[[noreturn]] void fail(const std::string& what, int err = errno)
+{
+    throw std::runtime_error(what + ": " + std::strerror(err));
+}
+
+[[noreturn]] void corrupt(const std::string& path, const char* what)
+{
+    throw std::runtime_error("snapshot '" + path + "' is " + what);
+}
+
+// Appends to a file descriptor, padding each section to the alignment.
+class SectionWriter {
+public:
+    SectionWriter(int fd, const std::string& path)
+        : fd_(fd)
+        , path_(path)
+    {
+    }
+
+    void write(const void* data, std::size_t size)
+    {
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t put = ::write(fd_, p, size);
+            if (put < 0) {
+                if (errno == EINTR)
+                    continue;
+                fail("cannot write " + path_);
+            }
+            p += put;
+            size -= static_cast<std::size_t>(put);
+            written_ += static_cast<std::uint64_t>(put);
+        }
+    }
+
+    void align()
+    {
+        static const char zeros[kAlign] = {};
+        write(zeros, align_up(written_) - written_);
+    }
+
+    std::uint64_t written() const { return written_; }
+
+private:
+    int fd_;
+    const std::string& path_;
+    std::uint64_t written_ = 0;
+};
+
+} // namespace
+
+void write_snapshot(const std::string& path, const SnapshotInfo& info, const NameTable& names,
+                    const Graph& net, const std::vector<RouteRow>& rows)
+{
+    DV_SCOPE("save snapshot");
+    const NodeId n = names.size();
+    const std::uint64_t stride = RouteMatrix::stride_for(n);
+    const std::uint64_t entries = net.offset(n);
+
+    std::vector<std::uint32_t> name_index(n + 1, 0);
+    for (NodeId x = 0; x < n; ++x)
+        name_index[x + 1] = name_index[x] + static_cast<std::uint32_t>(names.name(x).size());
+    std::vector<std::uint32_t> offsets(n + 1);
+    for (NodeId x = 0; x <= n; ++x)
+        offsets[x] = net.offset(x);
+
+    Header h = {};
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version = Snapshot::kVersion;
+    h.byte_order = kByteOrder;
+    h.nodes = n;
+    h.policy = static_cast<std::uint32_t>(info.policy);
+    h.infinity = info.infinity;
+    h.round = info.round;
+    h.entries = entries;
+    h.stride = stride;
+    h.name_bytes = name_index[n];
+    h.name_index = align_up(sizeof h);
+    h.name_text = align_up(h.name_index + (n + 1) * sizeof(std::uint32_t));
+    h.offsets = align_up(h.name_text + h.name_bytes);
+    h.targets = align_up(h.offsets + (n + 1) * sizeof(std::uint32_t));
+    h.costs = align_up(h.targets + entries * sizeof(NodeId));
+    h.dist = align_up(h.costs + entries * sizeof(Cost));
+    h.via = align_up(h.dist + n * stride * sizeof(Cost));
+    h.file_size = h.via + n * stride * sizeof(NodeId);
+
+    const std::string temp = path + ".tmp";
+    const int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        fail("cannot create " + temp);
+    try {
+        SectionWriter out(fd, temp);
+        out.write(&h, sizeof h);
+        out.align();
+        out.write(name_index.data(), name_index.size() * sizeof(std::uint32_t));
+        out.align();
+        for (NodeId x = 0; x < n; ++x)
+            out.write(names.name(x).data(), names.name(x).size());
+        out.align();
+        out.write(offsets.data(), offsets.size() * sizeof(std::uint32_t));
+        out.align();
+        out.write(net.targets(), entries * sizeof(NodeId));
+        out.align();
+        out.write(net.costs(), entries * sizeof(Cost));
+        out.align();
+        for (NodeId x = 0; x < n; ++x)
+            out.write(rows[x].dist, stride * sizeof(Cost));
+        out.align();
+        for (NodeId x = 0; x < n; ++x)
+            out.write(rows[x].via, stride * sizeof(NodeId));
+    } catch (...) {
+        ::close(fd);
+        ::unlink(temp.c_str());
+        throw;
+    }
+    // The descriptor is gone even when close() fails.
+    if (::close(fd) != 0) {
+        const int err = errno;
+        ::unlink(temp.c_str());
+        fail("cannot write " + temp, err);
+    }
+    if (::rename(temp.c_str(), path.c_str()) != 0) {
+        const int err = errno;
+        ::unlink(temp.c_str());
+        fail("cannot rename " + temp + " to " + path, err);
+    }
+}
+
+Snapshot Snapshot::open(const std::string& path)
+{
+    DV_SCOPE("load snapshot");
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        fail("cannot open " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        fail("cannot stat " + path, err);
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    if (size < sizeof(Header)) {
+        ::close(fd);
+        corrupt(path, "truncated");
+    }
+    // Private and writable: the engine's writes into adopted rows go to
+    // copied pages and never reach the file.
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    const int err = errno;
+    ::close(fd);
+    if (p == MAP_FAILED)
+        fail("cannot map " + path, err);
+
+    Snapshot snap;
+    snap.base_ = static_cast<char*>(p);
+    snap.size_ = size;
+
+    Header h;
+    std::memcpy(&h, snap.base_, sizeof h);
+    if (std::memcmp(h.magic, kMagic, sizeof kMagic) != 0)
+        corrupt(path, "not a snapshot");
+    if (h.byte_order != kByteOrder)
+        corrupt(path, "from a machine with another byte order");
+    if (h.version != kVersion) {
+        throw std::runtime_error("snapshot '" + path + "' has version " + std::to_string(h.version)
+                                 + "; this build reads version " + std::to_string(kVersion));
+    }
+    const std::uint64_t n = h.nodes;
+    if (h.stride != RouteMatrix::stride_for(h.nodes) || h.policy > 2 || h.infinity < 1
+        || h.infinity > kInfinity)
+        corrupt(path, "inconsistent");
+
+    // Every section must be aligned, in order and inside the file.
+    const std::uint64_t ends[] = {
+        sizeof h,
+        h.name_index, section_end(h.name_index, n + 1, sizeof(std::uint32_t)),
+        h.name_text, section_end(h.name_text, h.name_bytes, 1),
+        h.offsets, section_end(h.offsets, n + 1, sizeof(std::uint32_t)),
+        h.targets, section_end(h.targets, h.entries, sizeof(NodeId)),
+        h.costs, section_end(h.costs, h.entries, sizeof(Cost)),
+        h.dist, section_end(h.dist, n, h.stride * sizeof(Cost)),
+        h.via, section_end(h.via, n, h.stride * sizeof(NodeId)),
+    };
+    for (std::size_t i = 1; i < std::size(ends); ++i) {
+        if (ends[i] < ends[i - 1] || (i % 2 == 1 && ends[i] % kAlign != 0))
+            corrupt(path, "inconsistent");
+    }
+    if (h.file_size != ends[std::size(ends) - 1] || h.file_size != size)
+        corrupt(path, "truncated");
+
+    snap.info_ = {static_cast<PolicyKind>(h.policy), h.infinity, h.round};
+    snap.nodes_ = h.nodes;
+    snap.name_index_ = reinterpret_cast<const std::uint32_t*>(snap.base_ + h.name_index);
+    snap.name_text_ = snap.base_ + h.name_text;
+    snap.offsets_ = reinterpret_cast<const std::uint32_t*>(snap.base_ + h.offsets);
+    snap.targets_ = reinterpret_cast<const NodeId*>(snap.base_ + h.targets);
+    snap.costs_ = reinterpret_cast<const Cost*>(snap.base_ + h.costs);
+    snap.dist_ = reinterpret_cast<Cost*>(snap.base_ + h.dist);
+    snap.via_ = reinterpret_cast<NodeId*>(snap.base_ + h.via);
+
+    // Every section is checked here. The vectors feed the kernels and
+    // next hops index rows, so a bad entry would not fail cleanly later;
+    // one pass over them costs far less than reconverging.
+    if (snap.name_index_[0] != 0 || snap.name_index_[n] != h.name_bytes || snap.offsets_[0] != 0
+        || snap.offsets_[n] != h.entries)
+        corrupt(path, "inconsistent");
+    for (std::uint64_t x = 0; x < n; ++x) {
+        if (snap.name_index_[x + 1] < snap.name_index_[x] || snap.offsets_[x + 1] < snap.offsets_[x])
+            corrupt(path, "inconsistent");
+    }
+    for (std::uint64_t e = 0; e < h.entries; ++e) {
+        if (snap.targets_[e] >= n || snap.costs_[e] < 0 || snap.costs_[e] > kMaxLinkCost)
+            corrupt(path, "inconsistent");
+    }
+    for (std::uint64_t i = 0, cells = n * h.stride; i < cells; ++i) {
+        if (snap.dist_[i] < 0 || snap.dist_[i] > kInfinity || (snap.via_[i] >= n && snap.via_[i] != kNoNode))
+            corrupt(path, "inconsistent");
+    }
+    return snap;
+}
+
+Snapshot::Snapshot(Snapshot&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+Snapshot& Snapshot::operator=(Snapshot&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        base_ = std::exchange(other.base_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        info_ = other.info_;
+        nodes_ = std::exchange(other.nodes_, 0);
+        name_index_ = std::exchange(other.name_index_, nullptr);
+        name_text_ = std::exchange(other.name_text_, nullptr);
+        offsets_ = std::exchange(other.offsets_, nullptr);
+        targets_ = std::exchange(other.targets_, nullptr);
+        costs_ = std::exchange(other.costs_, nullptr);
+        dist_ = std::exchange(other.dist_, nullptr);
+        via_ = std::exchange(other.via_, nullptr);
+    }
+    return *this;
+}
+
+Snapshot::~Snapshot()
+{
+    release();
+}
+
+void Snapshot::release()
+{
+    if (base_ != nullptr)
+        munmap(base_, size_);
+    base_ = nullptr;
+    size_ = 0;
+}
+
+Topology Snapshot::topology() const
+{
+    Topology topo;
+    for (NodeId x = 0; x < nodes_; ++x) {
+        const std::uint32_t first = name_index_[x];
+        topo.names.add(std::string_view(name_text_ + first, name_index_[x + 1] - first));
+    }
+    topo.names.build_index();
+    for (NodeId x = 0; x < nodes_; ++x) {
+        for (std::uint32_t e = offsets_[x]; e < offsets_[x + 1]; ++e) {
+            if (x < targets_[e])
+                topo.links.push_back({x, targets_[e], costs_[e]});
+        }
+    }
+    return topo;
+}
+
+} // namespace dv
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "cost.hpp"
+#include "graph.hpp"
+#include "input.hpp"
+#include "names.hpp"
+#include "policy.hpp"
+#include "route_matrix.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dv {
+
+// What a snapshot's tables were converged under.
+struct SnapshotInfo {
+    PolicyKind policy = PolicyKind::plain;
+    Cost infinity = kInfinity;
+    int round = 0; // last round printed
+};
+
+// Writes the router names, the CSR adjacency and rows[x] for every router
+// to path, through a temporary file renamed into place. Throws
+// std::runtime_error on I/O errors.
+//
+// The file is a fixed header followed by 64-byte-aligned sections in
+// native byte order, with the vectors laid out exactly as a RouteMatrix,
+// so a later run can map them and start computing without a copy.
+void write_snapshot(const std::string& path, const SnapshotInfo& info, const NameTable& names,
+                    const Graph& net, const std::vector<RouteRow>& rows);
+
+// A snapshot mapped copy-on-write: the engine adopts its vectors in place
+// and pages are read, or copied on first write, as they are touched.
+class Snapshot {
+public:
+    static constexpr std::uint32_t kVersion = 1;
+
+    Snapshot() = default;
+    // Throws std::runtime_error if the file cannot be mapped, is not a
+    // snapshot of this version and byte order, or is inconsistent.
+    static Snapshot open(const std::string& path);
+
+    Snapshot(Snapshot&& other) noexcept;
+    Snapshot& operator=(Snapshot&& other) noexcept;
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+    ~Snapshot();
+
+    const SnapshotInfo& info() const { return info_; }
+    NodeId node_count() const { return nodes_; }
+
+    // The names and links; the UPDATE section is left empty.
+    Topology topology() const;
+
+    // Every router's vector, with RouteMatrix::stride_for(node_count()).
+    Cost* dist() { return dist_; }
+    NodeId* via() { return via_; }
+
+private:
+    void release();
+
+    char* base_ = nullptr;
+    std::size_t size_ = 0;
+    SnapshotInfo info_;
+    NodeId nodes_ = 0;
+    const std::uint32_t* name_index_ = nullptr;
+    const char* name_text_ = nullptr;
+    const std::uint32_t* offsets_ = nullptr;
+    const NodeId* targets_ = nullptr;
+    const Cost* costs_ = nullptr;
+    Cost* dist_ = nullptr;
+    NodeId* via_ = nullptr;
+};
+
+} // namespace dv
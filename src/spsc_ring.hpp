@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace dv {
+
+// Bounded queue between exactly one producer thread and one consumer
+// thread, without locks. Each side publishes its index with one release
+// store per batch and keeps a cached copy of the other side's, so a batch
+// reads the shared index only when the cached one says the ring is full
+// (or empty). The two indices sit on separate cache lines, so the sides
+// do not invalidate each other's line on every item.
+template <typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    // Holds capacity items, rounded up to a power of two.
+    explicit SpscRing(std::size_t capacity)
+    {
+        std::size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        mask_ = size - 1;
+        // Left uninitialised, so slots take memory once first used.
+        slots_.reset(new T[size]);
+    }
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer: appends as many of the count items as fit and returns how
+    // many that was.
+    std::size_t push(const T* items, std::size_t count)
+    {
+        const std::size_t tail = producer_.index.load(std::memory_order_relaxed);
+        if (mask_ + 1 - (tail - producer_.cached) < count)
+            producer_.cached = consumer_.index.load(std::memory_order_acquire);
+        count = std::min(count, mask_ + 1 - (tail - producer_.cached));
+        for (std::size_t i = 0; i < count; ++i)
+            slots_[(tail + i) & mask_] = items[i];
+        producer_.index.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: calls f on every item available, oldest first, then frees
+    // their slots; returns how many there were.
+    template <typename F>
+    std::size_t drain(F&& f)
+    {
+        const std::size_t head = consumer_.index.load(std::memory_order_relaxed);
+        if (consumer_.cached == head)
+            consumer_.cached = producer_.index.load(std::memory_order_acquire);
+        const std::size_t count = consumer_.cached - head;
+        for (std::size_t i = 0; i < count; ++i)
+            f(slots_[(head + i) & mask_]);
+        consumer_.index.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: whether nothing has been published since the last drain.
+    bool empty() const
+    {
+        return producer_.index.load(std::memory_order_acquire) == consumer_.index.load(std::memory_order_relaxed);
+    }
+
+private:
+    // One side's index and its copy of the other side's.
+    struct alignas(64) Side {
+        std::atomic<std::size_t> index{0};
+        std::size_t cached = 0;
+    };
+
+    Side producer_; // tail: written by the producer
+    Side consumer_; // head: written by the consumer
+    std::size_t mask_ = 0;
+    std::unique_ptr<T[]> slots_;
+};
+
+} // namespace dv
@@ -0,0 +1,73 @@
+#include "table_file.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace dv {
+
+namespace {
+
+std::size_t page_size()
+{
+    static const auto size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+} // namespace
+
+TableFile::TableFile(const std::string& dir)
+{
+    std::string path = dir + "/dv-tables-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    fd_ = ::mkostemp(name.data(), O_CLOEXEC);
+    if (fd_ < 0)
+        throw std::runtime_error("cannot create a table file in '" + dir + "': " + std::strerror(errno));
+    ::unlink(name.data());
+}
+
+TableFile::~TableFile()
+{
+    ::close(fd_);
+}
+
+void* TableFile::map(std::size_t bytes)
+{
+    bytes = (bytes + page_size() - 1) / page_size() * page_size();
+    std::size_t offset;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        offset = size_;
+        if (::ftruncate(fd_, static_cast<off_t>(offset + bytes)) != 0)
+            throw std::bad_alloc();
+        size_ += bytes;
+    }
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd_,
+                     static_cast<off_t>(offset));
+    if (p == MAP_FAILED)
+        throw std::bad_alloc();
+    return p;
+}
+
+void TableFile::discard(void* p, std::size_t bytes)
+{
+    ::madvise(p, bytes, MADV_REMOVE);
+}
+
+void TableFile::prefetch(const void* p, std::size_t bytes)
+{
+    // madvise takes whole pages.
+    const auto first = reinterpret_cast<std::uintptr_t>(p) & ~(page_size() - 1);
+    const auto last = reinterpret_cast<std::uintptr_t>(p) + bytes;
+    ::madvise(reinterpret_cast<void*>(first), last - first, MADV_WILLNEED);
+}
+
+} // namespace dv
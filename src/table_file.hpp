@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+namespace dv {
+
+// Scratch file backing arrays too large for memory. Each array is a shared
+// mapping of its own stretch of the file, so the kernel writes dirty pages
+// back and evicts them under memory pressure instead of the process running
+// out of memory. The file is sparse and unlinked as soon as it is created:
+// untouched pages take no disk, and nothing is left behind at exit. Once a
+// full disk stops a page from being written back, the process dies of
+// SIGBUS.
+class TableFile {
+public:
+    // Throws std::runtime_error if no file can be created in dir.
+    explicit TableFile(const std::string& dir);
+    TableFile(const TableFile&) = delete;
+    TableFile& operator=(const TableFile&) = delete;
+    ~TableFile();
+
+    // Maps bytes of fresh zero-filled space; throws std::bad_alloc if the
+    // file cannot grow or be mapped.
+    void* map(std::size_t bytes);
+
+    // Frees the disk behind a mapping from map() before it is unmapped.
+    static void discard(void* p, std::size_t bytes);
+    // Starts reading [p, p + bytes) of a mapping in ahead of use.
+    static void prefetch(const void* p, std::size_t bytes);
+
+private:
+    int fd_ = -1;
+    std::size_t size_ = 0;
+    std::mutex mutex_;
+};
+
+} // namespace dv
@@ -0,0 +1,118 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace dv {
+
+ThreadPool::ThreadPool(unsigned threads)
+    : shares_(std::make_unique<Share[]>(std::max(threads, 1u)))
+{
+    for (unsigned shard = 1; shard < threads; ++shard)
+        workers_.emplace_back([this, shard] { worker_loop(shard); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    start_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+void ThreadPool::run(std::size_t count, const Job& job)
+{
+    if (workers_.empty()) {
+        job(0, count, 0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+        count_ = count;
+        pending_ = static_cast<unsigned>(workers_.size());
+        ++generation_;
+    }
+    start_.notify_all();
+    run_shard(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    job_ = nullptr;
+}
+
+void ThreadPool::run_stealing(std::size_t count, std::size_t grain, const Job& job)
+{
+    const unsigned shards = size();
+    grain = std::max<std::size_t>(grain, 1);
+    for (unsigned shard = 0; shard < shards; ++shard) {
+        const std::uint64_t begin = count * shard / shards;
+        const std::uint64_t end = count * (shard + 1) / shards;
+        shares_[shard].range.store(begin << 32 | end, std::memory_order_relaxed);
+    }
+    // run() hands the shares over to the workers.
+    run(shards, [&](std::size_t, std::size_t, unsigned self) {
+        std::size_t begin;
+        std::size_t end;
+        while (claim(self, grain, true, begin, end))
+            job(begin, end, self);
+        // Nothing is ever added, so one pass over the others that finds
+        // every share empty means the job is done.
+        for (unsigned k = 1; k < shards; ++k) {
+            const unsigned victim = (self + k) % shards;
+            while (claim(victim, grain, false, begin, end))
+                job(begin, end, self);
+        }
+    });
+}
+
+bool ThreadPool::claim(unsigned shard, std::size_t grain, bool front, std::size_t& begin, std::size_t& end)
+{
+    std::atomic<std::uint64_t>& range = shares_[shard].range;
+    std::uint64_t seen = range.load(std::memory_order_relaxed);
+    while (true) {
+        const std::uint64_t lo = seen >> 32;
+        const std::uint64_t hi = seen & 0xffffffff;
+        if (lo >= hi)
+            return false;
+        const std::uint64_t cut = front ? std::min(lo + grain, hi) : hi - std::min<std::uint64_t>(grain, hi - lo);
+        const std::uint64_t left = front ? cut << 32 | hi : lo << 32 | cut;
+        if (range.compare_exchange_weak(seen, left, std::memory_order_relaxed)) {
+            begin = front ? lo : cut;
+            end = front ? cut : hi;
+            return true;
+        }
+    }
+}
+
+void ThreadPool::run_shard(unsigned shard)
+{
+    const std::size_t shards = size();
+    const std::size_t begin = count_ * shard / shards;
+    const std::size_t end = count_ * (shard + 1) / shards;
+    (*job_)(begin, end, shard);
+}
+
+void ThreadPool::worker_loop(unsigned shard)
+{
+    std::size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_)
+                return;
+            seen = generation_;
+        }
+        run_shard(shard);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --pending_;
+        }
+        done_.notify_one();
+    }
+}
+
+} // namespace dv
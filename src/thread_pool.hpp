@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dv {
+
+// Fixed set of worker threads that run one sharded job at a time. The
+// calling thread takes shard 0, so a pool of one thread spawns nothing.
+class ThreadPool {
+public:
+    // Called once per shard with [begin, end) and the shard index.
+    using Job = std::function<void(std::size_t begin, std::size_t end, unsigned shard)>;
+
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers_.size()) + 1; }
+
+    // Splits [0, count) into size() contiguous shards and blocks until every
+    // shard has run.
+    void run(std::size_t count, const Job& job);
+
+    // Like run(), for items of uneven cost: job gets chunks of at most
+    // grain items, with the index of the thread running them. Each thread
+    // starts on its own contiguous share, taking chunks from the front;
+    // once that is used up it takes chunks from the back of the others'
+    // until every share is empty. count must fit in 32 bits.
+    void run_stealing(std::size_t count, std::size_t grain, const Job& job);
+
+private:
+    void worker_loop(unsigned shard);
+    void run_shard(unsigned shard);
+
+    // One thread's unclaimed share for run_stealing(), as begin << 32 |
+    // end. The owner raises begin and thieves lower end, each by a
+    // compare-exchange, so a share never takes the same value twice.
+    struct alignas(64) Share {
+        std::atomic<std::uint64_t> range{0};
+    };
+    bool claim(unsigned shard, std::size_t grain, bool front, std::size_t& begin, std::size_t& end);
+
+    std::unique_ptr<Share[]> shares_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const Job* job_ = nullptr;
+    std::size_t count_ = 0;
+    std::size_t generation_ = 0;
+    unsigned pending_ = 0;
+    bool stopping_ = false;
+};
+
+} // namespace dv
@@ -0,0 +1,68 @@
+// Pops from a calendar queue whose delays span 1 to 1e9 ticks, against a
+// binary heap over the same events.
+
+#include "calendar_queue.hpp"
+
+#include "check.hpp"
+
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Event {
+    std::uint64_t time;
+    std::uint32_t to;
+};
+
+struct Later {
+    bool operator()(const Event& a, const Event& b) const
+    {
+        return a.time != b.time ? a.time > b.time : a.to > b.to;
+    }
+};
+
+using Queue = dv::CalendarQueue<Event, Later>;
+
+} // namespace
+
+int main()
+{
+    constexpr std::uint64_t kShortest = 1;
+    constexpr std::uint64_t kLongest = 1000000000;
+    Queue queue(kShortest, kLongest);
+    DV_CHECK(queue.bucket_count() <= Queue::kMaxBuckets);
+    std::priority_queue<Event, std::vector<Event>, Later> expected;
+
+    std::mt19937_64 rng(7);
+    const std::uint64_t delays[] = {kShortest, 2, 999, kLongest / 3, kLongest};
+    auto push = [&](std::uint64_t now) {
+        const Event e{now + delays[rng() % std::size(delays)], static_cast<std::uint32_t>(rng() % 16)};
+        queue.push(e);
+        expected.push(e);
+    };
+    for (int i = 0; i < 64; ++i)
+        push(0);
+
+    // Each pop schedules up to two more, like a router passing news on,
+    // until enough have gone by.
+    std::uint64_t popped = 0;
+    while (!queue.empty()) {
+        DV_CHECK(queue.size() == expected.size());
+        const Event got = queue.top();
+        const Event want = expected.top();
+        DV_CHECK(got.time == want.time && got.to == want.to);
+        const Event* next = queue.next_in_bucket();
+        DV_CHECK(next != nullptr && next->time == got.time);
+        queue.pop();
+        expected.pop();
+        if (++popped < 200000) {
+            for (int k = static_cast<int>(rng() % 3); k > 0; --k)
+                push(got.time);
+        }
+    }
+    DV_CHECK(expected.empty());
+    return 0;
+}
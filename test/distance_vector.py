@@ -1,19 +1,99 @@
 #!/usr/bin/env python3
 import sys
 
+INF = float("inf")
+
 class Graph:
     def __init__(self):
         self.adj_list = {}
 
     def add_edge(self, u, v, weight):
+        if u == v:
+            return
         self.adj_list.setdefault(u, {})
         self.adj_list.setdefault(v, {})
         self.adj_list[u][v] = weight
         self.adj_list[v][u] = weight
 
+    def remove_edge(self, u, v):
+        self.adj_list.get(u, {}).pop(v, None)
+        self.adj_list.get(v, {}).pop(u, None)
+
 node_list = []
 net = Graph()
 
+def check_router(name):
+    if name not in net.adj_list:
+        sys.exit(f"unknown router '{name}'")
+
+def link_fields(line):
+    # A fourth field is the link's delay, which only timing cares about.
+    fields = line.split()
+    if len(fields) not in (3, 4):
+        sys.exit(f"malformed link line '{line}'")
+    return fields[:3]
+
+def neighbours(x):
+    return [v for v in node_list if v in net.adj_list[x]]
+
+def fmt(cost):
+    return "INF" if cost == INF else str(cost)
+
+def cell(text):
+    return f"{text:<4} "
+
+def compute(prev):
+    cur = {}
+    for x in node_list:
+        row = {}
+        for y in node_list:
+            if y == x:
+                row[y] = (0, x)
+                continue
+            best = (INF, None)
+            for v in neighbours(x):
+                d = net.adj_list[x][v] + prev[v][y][0]
+                if d < best[0]:
+                    best = (d, v)
+            row[y] = best
+        cur[x] = row
+    return cur
+
+def print_distance_tables(prev, t):
+    for x in node_list:
+        cols = neighbours(x)
+        print(f"Distance Table of router {x} at t={t}:")
+        print(("".join([cell("")] + [cell(v) for v in cols])).rstrip())
+        for y in node_list:
+            if y == x:
+                continue
+            cells = [cell(fmt(net.adj_list[x][v] + prev[v][y][0])) for v in cols]
+            print(("".join([cell(y)] + cells)).rstrip())
+        print()
+
+def print_routing_tables(tables):
+    for x in node_list:
+        print(f"Routing Table of router {x}:")
+        for y in node_list:
+            if y == x:
+                continue
+            cost, via = tables[x][y]
+            if cost == INF:
+                print(f"{y},INF,INF")
+            else:
+                print(f"{y},{via},{cost}")
+        print()
+
+def converge(prev, t):
+    while True:
+        cur = compute(prev)
+        print_distance_tables(prev, t)
+        done = cur == prev
+        prev = cur
+        if done:
+            return prev, t
+        t += 1
+
 # Read node names
 line = sys.stdin.readline().strip()
 while line != "START":
@@ -24,6 +104,31 @@ while line != "START":
 # Read initial links
 line = sys.stdin.readline().strip()
 while line != "UPDATE":
-    a, b, cost = line.split()
+    a, b, cost = link_fields(line)
+    check_router(a)
+    check_router(b)
     net.add_edge(a, b, int(cost))
-    line = sys.stdin.readline().strip()
\ No newline at end of file
+    line = sys.stdin.readline().strip()
+
+tables = {x: {y: (0, x) if y == x else (INF, None) for y in node_list}
+          for x in node_list}
+tables, t = converge(tables, 0)
+print_routing_tables(tables)
+
+# Read link changes; a cost of -1 removes the link
+changed = False
+line = sys.stdin.readline().strip()
+while line not in ("END", ""):
+    a, b, cost = link_fields(line)
+    check_router(a)
+    check_router(b)
+    if int(cost) == -1:
+        net.remove_edge(a, b)
+    else:
+        net.add_edge(a, b, int(cost))
+    changed = True
+    line = sys.stdin.readline().strip()
+
+if changed:
+    tables, t = converge(tables, t + 1)
+    print_routing_tables(tables)
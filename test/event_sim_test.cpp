@@ -0,0 +1,40 @@
+// Simulates links whose delays span the whole range the parser accepts,
+// 0.001 ms to 1000 s, and checks the routes against Dijkstra.
+
+#include "event_sim.hpp"
+#include "input.hpp"
+#include "link_state.hpp"
+#include "policy.hpp"
+
+#include "check.hpp"
+
+#include <string_view>
+
+int main()
+{
+    constexpr std::string_view kInput = "A\nB\nC\nD\n"
+                                        "START\n"
+                                        "A B 1 0.001\n"
+                                        "B C 2\n"
+                                        "C D 1 1000000\n"
+                                        "A D 9 0.5\n"
+                                        "UPDATE\n"
+                                        "A D -1\n"
+                                        "END\n";
+    const dv::Topology topo = dv::parse_input(kInput);
+    dv::EventSim<dv::Plain> sim(topo, dv::SimConfig{});
+    DV_CHECK(sim.bucket_count() <= 4096);
+
+    dv::LinkState reference(topo);
+    const dv::SimReport first = sim.converge();
+    DV_CHECK(reference.verify(sim.rows(), dv::kInfinity).mismatches == 0);
+    // D learns of B from A after 0.5 ms, then the cheaper route through C
+    // after 1000 s.
+    DV_CHECK(first.end >= 1000000000);
+
+    DV_CHECK(sim.apply_updates(topo.updates));
+    sim.converge();
+    reference.apply_updates(topo.updates);
+    DV_CHECK(reference.verify(sim.rows(), dv::kInfinity).mismatches == 0);
+    return 0;
+}
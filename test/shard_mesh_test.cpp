@@ -0,0 +1,131 @@
+// Single-slot rings between shards, so nearly every send finds its ring
+// full: a stopped run keeps what did not fit for flush(), and threads
+// forwarding tokens get every one delivered exactly once before any of
+// them sees the run end.
+
+#include "shard_mesh.hpp"
+
+#include "check.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using dv::Advertisement;
+using dv::ShardMesh;
+
+void stopped_send_is_flushed()
+{
+    ShardMesh mesh(2, 1);
+    mesh.start();
+    mesh.stop();
+    const Advertisement batch[] = {{0, 1, 1, 0}, {0, 2, 2, 0}, {0, 3, 3, 0}};
+    int drained = 0;
+    mesh.send(0, 1, batch, std::size(batch), [&](const Advertisement&) { ++drained; });
+    DV_CHECK(drained == 0);
+
+    std::vector<dv::Cost> got;
+    mesh.flush([&](std::uint32_t to, const Advertisement& ad) {
+        DV_CHECK(to == 1);
+        got.push_back(ad.dist);
+    });
+    DV_CHECK((got == std::vector<dv::Cost>{1, 2, 3}));
+    mesh.flush([&](std::uint32_t, const Advertisement&) { DV_CHECK(false); });
+}
+
+void waiting_mail_wakes()
+{
+    ShardMesh mesh(2, 1);
+    mesh.start();
+    const Advertisement ad{0, 1, 1, 0};
+    mesh.send(0, 1, &ad, 1, [](const Advertisement&) {});
+    DV_CHECK(mesh.wait_for_work(1));
+    int received = 0;
+    DV_CHECK(mesh.receive(1, [&](const Advertisement&) { ++received; }));
+    DV_CHECK(received == 1);
+    DV_CHECK(!mesh.receive(1, [](const Advertisement&) { DV_CHECK(false); }));
+
+    ShardMesh alone(1, 1);
+    alone.start();
+    DV_CHECK(!alone.wait_for_work(0));
+}
+
+// Each shard starts kTokens tokens, which hop kHops times around the
+// shards in batches of three before they stop. A token's router is its
+// ID and its dist the hops left.
+void forwarded_tokens_arrive_once()
+{
+    constexpr std::uint32_t kShards = 4;
+    constexpr std::uint32_t kTokens = 300;
+    constexpr std::uint32_t kHops = 20;
+    constexpr std::uint64_t kDeliveries = std::uint64_t{kShards} * kTokens * kHops;
+    ShardMesh mesh(kShards, 1);
+    std::vector<std::atomic<std::uint32_t>> seen(kShards * kTokens * kHops);
+    std::atomic<std::uint64_t> delivered{0};
+
+    auto run = [&](std::uint32_t s) {
+        std::vector<Advertisement> queue;
+        auto deliver = [&](const Advertisement& ad) {
+            ++seen[ad.router * kHops + (kHops - ad.dist)];
+            ++delivered;
+            queue.push_back(ad);
+        };
+        auto forward = [&](std::vector<Advertisement>& batch) {
+            mesh.send(s, (s + 1 + batch.front().router % (kShards - 1)) % kShards, batch.data(),
+                      batch.size(), deliver);
+            batch.clear();
+        };
+
+        std::vector<Advertisement> batch;
+        for (std::uint32_t t = 0; t < kTokens; ++t) {
+            batch.push_back({s * kTokens + t, 0, kHops, s});
+            if (batch.size() == 3)
+                forward(batch);
+        }
+        if (!batch.empty())
+            forward(batch);
+        while (true) {
+            mesh.receive(s, deliver);
+            if (queue.empty()) {
+                if (!mesh.wait_for_work(s))
+                    break;
+                continue;
+            }
+            std::vector<Advertisement> next;
+            next.swap(queue);
+            for (Advertisement ad : next) {
+                if (--ad.dist == 0)
+                    continue;
+                batch.push_back(ad);
+                if (batch.size() == 3)
+                    forward(batch);
+            }
+            if (!batch.empty())
+                forward(batch);
+        }
+        DV_CHECK(delivered.load() == kDeliveries);
+    };
+
+    mesh.start();
+    std::vector<std::thread> threads;
+    for (std::uint32_t s = 0; s < kShards; ++s)
+        threads.emplace_back(run, s);
+    for (auto& t : threads)
+        t.join();
+    DV_CHECK(!mesh.stopped());
+    for (const auto& count : seen)
+        DV_CHECK(count.load() == 1);
+}
+
+} // namespace
+
+int main()
+{
+    stopped_send_is_flushed();
+    waiting_mail_wakes();
+    forwarded_tokens_arrive_once();
+    return 0;
+}